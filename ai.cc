@@ -1,26 +1,287 @@
 #include "ai.h"
 #include "parameters.h"
+#include "search_stats.h"
+#include "profiler.h"
 #include <iostream>
 #include <random>
 #include <chrono>
 #include <vector>
 #include <algorithm>
 
+// The counters of the search running on this thread.
+// They are added to the ai's stats when the search ends.
+static thread_local SearchStats thread_stats;
+
 Ai::Ai(){}
 
+void Ai::BeginSearchStats()
+{
+    last_stats.Reset();
+    thread_stats.Reset();
+    search_start = std::chrono::steady_clock::now();
+}
+
+void Ai::EndSearchStats()
+{
+    last_stats.Add(thread_stats);
+    last_stats.depth = parameters.search_depth + 1;
+    last_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count();
+
+    if(verbose)
+        std::cout<<last_stats.ToText();
+}
+
+float Ai::EvaluateLeaf(Board *board)
+{
+    ++thread_stats.leaf_evaluations;
+
+    ScopedTimer timer(&thread_stats.evaluate_ns);
+    if(network != nullptr)
+        return board->EvaluateNetwork();
+
+    return board->Evaluate(parameters);
+}
+
+bool Ai::TimedMakeMove(Board *board, const Coordinate& move)
+{
+    ScopedTimer timer(&thread_stats.make_move_ns);
+    return board->MakeMove(move);
+}
+
+void Ai::GenerateSearchMoves(Board *board, int side, std::vector<Coordinate> *moves, int *likely_moves)
+{
+    if(policy != nullptr && side == board->GetSideToMove())
+    {
+        std::vector<float> probabilities;
+        policy->GenerateMoves(board, moves, &probabilities);
+
+        // The moves are sorted, so the most
+        // likely ones come first.
+        float covered = 0;
+        *likely_moves = 0;
+        while(*likely_moves < static_cast<int>(probabilities.size()) && covered < parameters.policy_coverage)
+            covered += probabilities[(*likely_moves)++];
+    }
+    else
+    {
+        board->GenerateMoves(moves, side, parameters);
+        *likely_moves = static_cast<int>(moves->size());
+    }
+
+    if(read_ladders)
+        ReadLadders(board, side, moves);
+}
+
+int Ai::MovesToConsider(int depth, int likely_moves) const
+{
+    if(!parameters.progressive_widening)
+        return parameters.moves_to_consider;
+
+    int narrowest = std::max(1, parameters.min_moves_to_consider);
+
+    int widest = parameters.max_moves_to_consider;
+    if(depth > parameters.search_depth)
+        widest = parameters.root_moves_to_consider;
+    else if(parameters.search_depth > 1)
+        widest = narrowest + (widest - narrowest)*(depth - 1)/(parameters.search_depth - 1);
+
+    widest = std::max(widest, narrowest);
+
+    // In the second half of the time budget the
+    // nodes narrow down with the time that is left.
+    if(time_budget_ms != kNoTimeBudget)
+    {
+        auto left = std::chrono::duration<double,std::milli>(search_deadline - std::chrono::steady_clock::now()).count();
+        double fraction = std::max(0.0, left/time_budget_ms);
+        if(fraction < 0.5)
+            widest = narrowest + static_cast<int>((widest - narrowest)*fraction*2);
+    }
+
+    return std::max(narrowest, std::min(widest, likely_moves));
+}
+
+void Ai::ReadLadders(Board *board, int side, std::vector<Coordinate> *moves)
+{
+    int opponent = (side == WHITE)?BLACK:WHITE;
+
+    const std::vector<Group>& own_groups = board->GetGroups(side);
+    const std::vector<Group>& opponent_groups = board->GetGroups(opponent);
+
+    for(int index : board->GetAtariGroups(side))
+    {
+        const Group& group = own_groups[index];
+        const Coordinate& escape = group.liberties[0];
+
+        // Capturing a neighbor may still be worth it
+        // even if the group itself can't be saved.
+        if(Captures(board, side, escape) || !ladder_reader.IsCaptured(*board, group.stones[0]))
+            continue;
+
+        moves->erase(std::remove(moves->begin(), moves->end(), escape), moves->end());
+    }
+
+    for(int index : board->GetTwoLibertyGroups(opponent))
+    {
+        const Group& group = opponent_groups[index];
+        for(const Coordinate& atari : group.liberties)
+        {
+            if(board->Occupied(atari) || !ladder_reader.AtariCaptures(*board, group.stones[0], atari))
+                continue;
+
+            moves->erase(std::remove(moves->begin(), moves->end(), atari), moves->end());
+            moves->insert(moves->begin(), atari);
+            break;
+        }
+    }
+}
+
+bool Ai::Captures(Board *board, int side, const Coordinate& c)
+{
+    int opponent = (side == WHITE)?BLACK:WHITE;
+
+    for(int index : board->GetAtariGroups(opponent))
+    {
+        if(board->GetGroups(opponent)[index].liberties[0] == c)
+            return true;
+    }
+    return false;
+}
+
+void Ai::SolveLifeAndDeath(Board *board, int side, std::vector<Coordinate> *moves)
+{
+    PROFILE_ZONE("Ai::SolveLifeAndDeath");
+
+    int opponent = (side == WHITE)?BLACK:WHITE;
+
+    LifeOptions options;
+    options.max_nodes = kRootLifeNodes;
+
+    const std::vector<Group>& own_groups = board->GetGroups(side);
+    const std::vector<Group>& opponent_groups = board->GetGroups(opponent);
+
+    for(const std::vector<int>* indices : {&board->GetAtariGroups(side), &board->GetTwoLibertyGroups(side)})
+    {
+        for(int index : *indices)
+        {
+            const Group& group = own_groups[index];
+            if(life_solver.Solve(*board, group.stones[0], options).status != LIFE_DEAD)
+                continue;
+
+            // Always keep something to play.
+            for(const Coordinate& liberty : group.liberties)
+            {
+                if(moves->size() > 1 && !Captures(board, side, liberty))
+                    moves->erase(std::remove(moves->begin(), moves->end(), liberty), moves->end());
+            }
+        }
+    }
+
+    for(const std::vector<int>* indices : {&board->GetAtariGroups(opponent), &board->GetTwoLibertyGroups(opponent)})
+    {
+        for(int index : *indices)
+        {
+            LifeResult result = life_solver.Solve(*board, opponent_groups[index].stones[0], options);
+            if(result.status != LIFE_DEAD || result.key_move == kPassMove)
+                continue;
+
+            moves->erase(std::remove(moves->begin(), moves->end(), result.key_move), moves->end());
+            moves->insert(moves->begin(), result.key_move);
+        }
+    }
+}
+
+void Ai::AttachNetwork(Board *board)
+{
+    if(network != nullptr && board->GetNetwork() != network)
+        board->SetNetwork(network);
+}
+
+void Ai::StartSearchClock()
+{
+    search_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_budget_ms);
+}
+
+bool Ai::OutOfTime() const
+{
+    if(time_budget_ms == kNoTimeBudget)
+        return false;
+
+    return std::chrono::steady_clock::now() >= search_deadline;
+}
+
+bool Ai::ProbeBook(Board *board, Coordinate *move)
+{
+    if(!opening_book->Probe(*board, move))
+        return false;
+
+    if(board->Occupied(*move) || !board->MakeMove(*move))
+        return false;
+
+    board->UndoLastMove();
+    return true;
+}
+
+float Ai::TraceNode(Board *board, int ply, float alpha, float beta, float value, int flags)
+{
+    TraceRecord record;
+    record.ply = ply;
+    record.move = kTraceNoMove;
+    record.flags = flags;
+    record.side_to_move = board->GetSideToMove();
+    record.alpha = alpha;
+    record.beta = beta;
+    record.score = value;
+
+    Coordinate last_move;
+    if(ply > 0 && board->GetLastMove(&last_move))
+        record.move = (last_move == kPassMove)?kTracePass:last_move.As1D();
+
+    search_trace->Add(record);
+    return value;
+}
+
 float Ai::MiniMax(Board *board, int depth, float alpha, float beta)
 {
-    if(depth == 0)
-        return board->Evaluate();
+    PROFILE_ZONE("Ai::MiniMax");
+
+    ++thread_stats.nodes;
+
+    // The root calls this after playing one of its moves.
+    int ply = parameters.search_depth - depth + 1;
+
+    if(depth == 0 || OutOfTime())
+    {
+        float value = EvaluateLeaf(board);
+        if(search_trace != nullptr)
+            TraceNode(board, ply, alpha, beta, value, TRACE_LEAF | ((depth == 0)?0:TRACE_OUT_OF_TIME));
+        return value;
+    }
 
     int side_to_move = board->GetSideToMove();
 
     std::vector<Coordinate> moves;
-    board->GenerateMoves(&moves, side_to_move);
+    int likely_moves;
+    {
+        ScopedTimer timer(&thread_stats.generate_moves_ns);
+        GenerateSearchMoves(board, side_to_move, &moves, &likely_moves);
+    }
 
     if(moves.size() == 0)
-        return board->Evaluate();
+    {
+        float value = EvaluateLeaf(board);
+        if(search_trace != nullptr)
+            TraceNode(board, ply, alpha, beta, value, TRACE_LEAF);
+        return value;
+    }
 
+    ++thread_stats.interior_nodes;
+
+    // The window this node was called with, for the trace.
+    float alpha_in = alpha;
+    float beta_in = beta;
+    int flags = 0;
+
+    int moves_to_consider = MovesToConsider(depth, likely_moves);
     int moves_considered = 0;
     if(side_to_move == BLACK)
     {
@@ -29,12 +290,13 @@ float Ai::MiniMax(Board *board, int depth, float alpha, float beta)
         for(auto move : moves)
         {
 
-            if(moves_considered++ == kMovesToConsider)
+            if(moves_considered++ == moves_to_consider)
                     break;
 
-            if(!board->MakeMove(move))
+            if(!TimedMakeMove(board, move))
                 continue;
 
+            ++thread_stats.children_searched;
             value = std::max(value, MiniMax(board,depth-1,alpha,beta));
             board->UndoLastMove();
 
@@ -42,11 +304,15 @@ float Ai::MiniMax(Board *board, int depth, float alpha, float beta)
 
             if(alpha >= beta)
             {
-                //std::cout<<"Alpha cutoff\n";
+                thread_stats.RecordCutoff(moves_considered - 1);
+                flags = TRACE_CUTOFF;
                 break;
             }
         }
 
+        if(search_trace != nullptr)
+            TraceNode(board, ply, alpha_in, beta_in, value, flags);
+
         return value;
     }
     else
@@ -56,33 +322,47 @@ float Ai::MiniMax(Board *board, int depth, float alpha, float beta)
         for(auto move : moves)
         {
 
-            if(moves_considered++ == kMovesToConsider)
+            if(moves_considered++ == moves_to_consider)
                     break;
 
-            if(!board->MakeMove(move))
+            if(!TimedMakeMove(board, move))
                 continue;
 
+            ++thread_stats.children_searched;
             value = std::min(value, MiniMax(board,depth-1,alpha,beta));
             board->UndoLastMove();
 
             beta = std::min(beta, value);
             if(beta <= alpha)
             {
-                //std::cout<<"Beta cutoff\n";
+                thread_stats.RecordCutoff(moves_considered - 1);
+                flags = TRACE_CUTOFF;
                 break;
             }
         }
 
+        if(search_trace != nullptr)
+            TraceNode(board, ply, alpha_in, beta_in, value, flags);
+
         return value;
     }
 }
 
 bool Ai::GetBestMove(Board *board, Coordinate *best_move)
 {
+    last_stats.Reset();
+
+    if(opening_book != nullptr && ProbeBook(board, best_move))
+        return true;
+
     int side_to_move = board->GetSideToMove();
 
     std::vector<Coordinate> moves;
-    board->GenerateMoves(&moves,side_to_move);
+    int likely_moves;
+    GenerateSearchMoves(board, side_to_move, &moves, &likely_moves);
+
+    if(solve_life)
+        SolveLifeAndDeath(board, side_to_move, &moves);
 
     Coordinate current_best = {-1,-1};
 
@@ -93,34 +373,51 @@ bool Ai::GetBestMove(Board *board, Coordinate *best_move)
     else
         return false;
 
-    // Don't search on the first few moves.
-    // Just play some of the generated moves.
-    if(board->GetMovesPlayed() < 4)
+    // Without a book, don't search on the first few
+    // moves. Just play some of the generated moves.
+    if(opening_book == nullptr && board->GetMovesPlayed() < 4)
     {
         *best_move = moves[0];
         return true;
     }
 
-    std::cout<<"AI thinking...\n";
+    if(verbose)
+        std::cout<<"AI thinking...\n";
 
-    int current_eval = board->Evaluate();
+    StartSearchClock();
+    BeginSearchStats();
+    AttachNetwork(board);
 
+    // The root counts as an interior node.
+    ++thread_stats.nodes;
+    ++thread_stats.interior_nodes;
+
+    PROFILE_ZONE("Ai::RootSearch");
+
+    int moves_to_consider = MovesToConsider(parameters.search_depth + 1, likely_moves);
     int moves_considered = 0;
     float value = -1000;
 
     for(auto move : moves)
     {
-        if(moves_considered++ == kMovesToConsider)
+        if(moves_considered++ == moves_to_consider)
             break;
 
-        if(!board->MakeMove(move))
+        // Always search at least one move so
+        // that there is something to play.
+        if(moves_considered > 1 && OutOfTime())
+            break;
+
+        if(!TimedMakeMove(board, move))
             continue;
 
+        ++thread_stats.children_searched;
+
 #ifdef SEARCH_INFO 
         std::cout<<"Evaluation for move ("<<move.x<<","<<move.y<<"): ";
 #endif
 
-        float eval = MiniMax(board,kSearchDepth,-1000,1000);
+        float eval = MiniMax(board,parameters.search_depth,-1000,1000);
 
 #ifdef SEARCH_INFO
         std::cout<<eval<<"\n";
@@ -144,7 +441,13 @@ bool Ai::GetBestMove(Board *board, Coordinate *best_move)
 
     }
 
-    std::cout<<"Best move: ("<<current_best.x<<","<<current_best.y<<")\n"; 
+    EndSearchStats();
+
+    if(search_trace != nullptr)
+        TraceNode(board, 0, -1000, 1000, value, 0);
+
+    if(verbose)
+        std::cout<<"Best move: ("<<current_best.x<<","<<current_best.y<<")\n"; 
 
     if(value == -1000 || value == 1000)
         return false;
@@ -165,10 +468,20 @@ bool Ai::GetBestMove(Board *board, Coordinate *best_move)
 
 bool Ai::PlayMove(Board *board)
 {
+    last_stats.Reset();
+
+    Coordinate book_move;
+    if(opening_book != nullptr && ProbeBook(board, &book_move))
+        return board->MakeMove(book_move);
+
     int side_to_move = board->GetSideToMove();
 
     std::vector<Coordinate> moves;
-    board->GenerateMoves(&moves,side_to_move);
+    int likely_moves;
+    GenerateSearchMoves(board, side_to_move, &moves, &likely_moves);
+
+    if(solve_life)
+        SolveLifeAndDeath(board, side_to_move, &moves);
 
     /*
     std::cout<<"Moves: \n";
@@ -185,34 +498,51 @@ bool Ai::PlayMove(Board *board)
     else
         return false;
 
-    // Don't search on the first few moves.
-    // Just play some of the generated moves.
-    if(board->GetMovesPlayed() < 4)
+    // Without a book, don't search on the first few
+    // moves. Just play some of the generated moves.
+    if(opening_book == nullptr && board->GetMovesPlayed() < 4)
     {
         board->MakeMove(moves[0]);
         return true;
     }
 
-    std::cout<<"AI thinking...\n";
+    if(verbose)
+        std::cout<<"AI thinking...\n";
+
+    StartSearchClock();
+    BeginSearchStats();
+    AttachNetwork(board);
 
-    int current_eval = board->Evaluate();
+    // The root counts as an interior node.
+    ++thread_stats.nodes;
+    ++thread_stats.interior_nodes;
 
+    PROFILE_ZONE("Ai::RootSearch");
+
+    int moves_to_consider = MovesToConsider(parameters.search_depth + 1, likely_moves);
     int moves_considered = 0;
     float value = -1000;
 
     for(auto move : moves)
     {
-        if(moves_considered++ == kMovesToConsider)
+        if(moves_considered++ == moves_to_consider)
+            break;
+
+        // Always search at least one move so
+        // that there is something to play.
+        if(moves_considered > 1 && OutOfTime())
             break;
 
-        if(!board->MakeMove(move))
+        if(!TimedMakeMove(board, move))
             continue;
 
+        ++thread_stats.children_searched;
+
 #ifdef SEARCH_INFO 
         std::cout<<"Evaluation for move ("<<move.x<<","<<move.y<<"): ";
 #endif
 
-        float eval = MiniMax(board,kSearchDepth,-1000,1000);
+        float eval = MiniMax(board,parameters.search_depth,-1000,1000);
 
 #ifdef SEARCH_INFO
         std::cout<<eval<<"\n";
@@ -236,7 +566,13 @@ bool Ai::PlayMove(Board *board)
 
     }
 
-    std::cout<<"Best move: ("<<current_best.x<<","<<current_best.y<<")\n"; 
+    EndSearchStats();
+
+    if(search_trace != nullptr)
+        TraceNode(board, 0, -1000, 1000, value, 0);
+
+    if(verbose)
+        std::cout<<"Best move: ("<<current_best.x<<","<<current_best.y<<")\n"; 
 
     if(current_best.x != -1)
     {
@@ -2,8 +2,20 @@
 #define AI_H
 
 #include "board.h"
+#include "ladder.h"
+#include "life_death.h"
+#include "opening_book.h"
+#include "policy.h"
+#include "search_stats.h"
+#include "search_trace.h"
+#include <chrono>
+#include <cstdint>
 
 const float kNoPreviousEvaluation = 1000;
+const int kNoTimeBudget = 0;
+
+// Node budget of each life and death read at the root.
+const int kRootLifeNodes = 2000;
 
 class Ai
 {
@@ -15,8 +27,130 @@ public:
 
     float MiniMax(Board *board, int depth, float alpha, float beta);
 
+    // Limits the time spent on a single search.
+    // When the budget runs out the remaining nodes
+    // are scored with a static evaluation.
+    void SetTimeBudget(int milliseconds) { time_budget_ms = milliseconds; }
+
+    // Depth of the search below each root move.
+    void SetSearchDepth(int depth) { parameters.search_depth = depth; }
+
+    // Evaluation weights and search limits used
+    // by the following searches.
+    void SetParameters(const Parameters& value) { parameters = value; }
+    const Parameters& GetParameters() const { return parameters; }
+
+    // Counters of the latest search. They are all zero
+    // if the move didn't need a search, e.g. book moves.
+    const SearchStats& GetLastSearchStats() const { return last_stats; }
+
+    // Number of positions visited by the latest search.
+    uint64_t GetNodesSearched() const { return last_stats.nodes; }
+
+    // Turns the progress output on stdout on or off.
+    void SetVerbose(bool value) { verbose = value; }
+
+    // Plays book moves instead of searching while
+    // the position is in the book. The book has to
+    // outlive the ai. Pass nullptr to turn it off.
+    void SetOpeningBook(const OpeningBook *book) { opening_book = book; }
+
+    // Scores the leaves of the following searches with
+    // the network instead of Board::Evaluate. The network
+    // has to outlive the ai. Pass nullptr to turn it off.
+    void SetNetwork(const NnueNetwork *value) { network = value; }
+
+    // Orders the moves of the following searches by the
+    // policy instead of Board::GenerateMoves, so that the
+    // moves_to_consider cut keeps the most likely moves and
+    // nodes with a sure policy search fewer of them.
+    // The policy has to outlive the ai. Pass nullptr to
+    // turn it off.
+    void SetPolicy(const MovePolicy *value) { policy = value; }
+
+    // Reads ladders when generating moves, see ReadLadders.
+    // On by default.
+    void SetLadderReading(bool value) { read_ladders = value; }
+
+    // Reads the life and death of the groups with one or
+    // two liberties at the root, see SolveLifeAndDeath.
+    // Off by default, it costs time without a measured
+    // gain in strength yet.
+    void SetLifeSolving(bool value) { solve_life = value; }
+
+    // Streams every node of the following searches
+    // to the trace. Pass nullptr to stop tracing.
+    void SetSearchTrace(SearchTraceWriter *trace) { search_trace = trace; }
+
 private:
+    void StartSearchClock();
+    bool OutOfTime() const;
+
+    // Gets a legal book move for the position.
+    bool ProbeBook(Board *board, Coordinate *move);
+
+    void BeginSearchStats();
+    void EndSearchStats();
+
+    // Board calls made by the search, wrapped
+    // so that they are counted and timed.
+    float EvaluateLeaf(Board *board);
+    bool TimedMakeMove(Board *board, const Coordinate& move);
+
+    // Adds the node to the search trace and returns its value.
+    float TraceNode(Board *board, int ply, float alpha, float beta, float value, int flags);
+
     float previous_evaluation = kNoPreviousEvaluation;
+
+    Parameters parameters;
+
+    SearchStats last_stats;
+    std::chrono::steady_clock::time_point search_start;
+
+    int time_budget_ms = kNoTimeBudget;
+    std::chrono::steady_clock::time_point search_deadline;
+
+    bool verbose = true;
+
+    // The moves to search in a position, best first.
+    // likely_moves is the number of moves that hold
+    // policy_coverage of the policy's probability, or
+    // all of them without a policy.
+    void GenerateSearchMoves(Board *board, int side, std::vector<Coordinate> *moves, int *likely_moves);
+
+    // How many of the moves a node with the given depth
+    // left searches, see Parameters::progressive_widening.
+    // The root has depth search_depth + 1.
+    int MovesToConsider(int depth, int likely_moves) const;
+
+    // Drops the escapes of the side's groups that are
+    // caught in a ladder and moves the ataris that start
+    // a working ladder on the opponent to the front.
+    void ReadLadders(Board *board, int side, std::vector<Coordinate> *moves);
+
+    // Drops the moves that try to save the side's groups
+    // that die anyway and moves the killing moves against
+    // the opponent's groups to the front. Only used at the
+    // root since every read takes up to kRootLifeNodes moves.
+    void SolveLifeAndDeath(Board *board, int side, std::vector<Coordinate> *moves);
+
+    // Whether the point is the last liberty of one
+    // of the opponent's groups.
+    static bool Captures(Board *board, int side, const Coordinate& c);
+
+    // Sets the network on the board before a search.
+    void AttachNetwork(Board *board);
+
+    bool read_ladders = true;
+    LadderReader ladder_reader;
+
+    bool solve_life = false;
+    LifeSolver life_solver;
+
+    const NnueNetwork *network = nullptr;
+    const MovePolicy *policy = nullptr;
+    const OpeningBook *opening_book = nullptr;
+    SearchTraceWriter *search_trace = nullptr;
 };
 
 #endif
@@ -0,0 +1,415 @@
+#include "batch_eval.h"
+#include "benson.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    const int kNumPoints = kBoardSize*kBoardSize;
+
+    // The neighbors of every point. Points on the edge
+    // use themselves for the missing neighbors, which
+    // changes none of the results below and keeps the
+    // loops free of bounds checks.
+    struct NeighborTable
+    {
+        int points[kNumPoints][4];
+
+        NeighborTable()
+        {
+            for(int p = 0; p < kNumPoints; ++p)
+            {
+                int x = p % kBoardSize;
+                int y = p / kBoardSize;
+
+                points[p][0] = (x > 0)?p - 1:p;
+                points[p][1] = (x < kBoardSize - 1)?p + 1:p;
+                points[p][2] = (y > 0)?p - kBoardSize:p;
+                points[p][3] = (y < kBoardSize - 1)?p + kBoardSize:p;
+            }
+        }
+    };
+
+    const NeighborTable kNeighbors;
+
+    // Row pointers below are taken out of the lane
+    // loops by hand. The rows are uint8_t, which may
+    // alias anything, so the compiler would otherwise
+    // reload them on every lane and not vectorize.
+
+    // Working set of one chunk of positions.
+    struct Chunk
+    {
+        uint8_t color[kNumPoints][kBatchLanes];
+        uint8_t label[kNumPoints][kBatchLanes];
+        uint8_t reach_black[kNumPoints][kBatchLanes];
+        uint8_t reach_white[kNumPoints][kBatchLanes];
+        int16_t column_sum[kNumPoints][kBatchLanes];
+
+        int32_t influence[kBatchLanes];
+        int32_t liberties_black[kBatchLanes];
+        int32_t liberties_white[kBatchLanes];
+        int32_t territory_black[kBatchLanes];
+        int32_t territory_white[kBatchLanes];
+    };
+
+    // Unpacks the stone planes, padding the
+    // unused lanes with empty boards.
+    void LoadChunk(const PositionBatch& batch, size_t first, int lanes, Chunk *chunk)
+    {
+        for(int y = 0; y < kBoardSize; ++y)
+        {
+            uint16_t black[kBatchLanes] = {0};
+            uint16_t white[kBatchLanes] = {0};
+            std::copy(batch.black_rows[y].begin() + first, batch.black_rows[y].begin() + first + lanes, black);
+            std::copy(batch.white_rows[y].begin() + first, batch.white_rows[y].begin() + first + lanes, white);
+
+            for(int x = 0; x < kBoardSize; ++x)
+            {
+                uint8_t *color = chunk->color[y*kBoardSize + x];
+                for(int i = 0; i < kBatchLanes; ++i)
+                    color[i] = ((black[i] >> x) & 1)*BLACK + ((white[i] >> x) & 1)*WHITE;
+            }
+        }
+    }
+
+    // Sum over the empty points of the weighted stone
+    // balance in the 5x5 window around the point, the
+    // same as summing Board::EvaluatePoint. The window
+    // sums are done a column at a time.
+    void CalculateInfluence(const Parameters& parameters, Chunk *chunk)
+    {
+        for(int p = 0; p < kNumPoints; ++p)
+        {
+            int x = p % kBoardSize;
+            int y = p / kBoardSize;
+
+            int16_t *sum = chunk->column_sum[p];
+            std::fill(sum, sum + kBatchLanes, 0);
+
+            for(int j = std::max(0, y - 2); j <= std::min(kBoardSize - 1, y + 2); ++j)
+            {
+                const uint8_t *color = chunk->color[j*kBoardSize + x];
+                for(int i = 0; i < kBatchLanes; ++i)
+                    sum[i] += (color[i] == BLACK) - (color[i] == WHITE);
+            }
+        }
+
+        std::fill(chunk->influence, chunk->influence + kBatchLanes, 0);
+
+        for(int p = 0; p < kNumPoints; ++p)
+        {
+            int x = p % kBoardSize;
+            int y = p / kBoardSize;
+
+            bool edge = (x <= 1 || x >= kBoardSize - 2 || y <= 1 || y >= kBoardSize - 2);
+            int weight = edge?parameters.edge_point_evaluation:parameters.point_evaluation;
+
+            int16_t window[kBatchLanes] = {0};
+            for(int i2 = std::max(0, x - 2); i2 <= std::min(kBoardSize - 1, x + 2); ++i2)
+            {
+                const int16_t *sum = chunk->column_sum[y*kBoardSize + i2];
+                for(int i = 0; i < kBatchLanes; ++i)
+                    window[i] += sum[i];
+            }
+
+            const uint8_t *color = chunk->color[p];
+            for(int i = 0; i < kBatchLanes; ++i)
+                chunk->influence[i] += (color[i] == EMPTY)*weight*window[i];
+        }
+    }
+
+    // Labels every stone with the smallest point
+    // index + 1 of its group by spreading labels
+    // between neighboring stones of the same color
+    // until nothing changes in any of the lanes.
+    void LabelGroups(Chunk *chunk)
+    {
+        for(int p = 0; p < kNumPoints; ++p)
+        {
+            for(int i = 0; i < kBatchLanes; ++i)
+                chunk->label[p][i] = (chunk->color[p][i] != EMPTY)*(p + 1);
+        }
+
+        bool changed = true;
+        for(int pass = 0; changed; ++pass)
+        {
+            changed = false;
+
+            // Alternate the sweep direction so that labels
+            // travel along both ways of long groups.
+            for(int n = 0; n < kNumPoints; ++n)
+            {
+                int p = (pass % 2 == 0)?n:kNumPoints - 1 - n;
+
+                uint8_t *label = chunk->label[p];
+                const uint8_t *color = chunk->color[p];
+
+                uint8_t lane_changed = 0;
+                for(int k = 0; k < 4; ++k)
+                {
+                    int q = kNeighbors.points[p][k];
+                    if(q == p)
+                        continue;
+
+                    const uint8_t *other_label = chunk->label[q];
+                    const uint8_t *other_color = chunk->color[q];
+
+                    for(int i = 0; i < kBatchLanes; ++i)
+                    {
+                        uint8_t same = (color[i] != EMPTY) & (color[i] == other_color[i]);
+                        uint8_t smaller = same & (other_label[i] < label[i]);
+                        lane_changed |= smaller;
+                        label[i] = smaller?other_label[i]:label[i];
+                    }
+                }
+
+                changed |= (lane_changed != 0);
+            }
+        }
+    }
+
+    // The liberties of all groups added up, that is
+    // for every empty point the number of distinct
+    // groups of each color next to it.
+    void CountLiberties(Chunk *chunk)
+    {
+        std::fill(chunk->liberties_black, chunk->liberties_black + kBatchLanes, 0);
+        std::fill(chunk->liberties_white, chunk->liberties_white + kBatchLanes, 0);
+
+        for(int p = 0; p < kNumPoints; ++p)
+        {
+            const int *neighbors = kNeighbors.points[p];
+            const uint8_t *color = chunk->color[p];
+
+            const uint8_t *color0 = chunk->color[neighbors[0]];
+            const uint8_t *color1 = chunk->color[neighbors[1]];
+            const uint8_t *color2 = chunk->color[neighbors[2]];
+            const uint8_t *color3 = chunk->color[neighbors[3]];
+            const uint8_t *label0 = chunk->label[neighbors[0]];
+            const uint8_t *label1 = chunk->label[neighbors[1]];
+            const uint8_t *label2 = chunk->label[neighbors[2]];
+            const uint8_t *label3 = chunk->label[neighbors[3]];
+
+            for(int side : {BLACK, WHITE})
+            {
+                int32_t *liberties = (side == BLACK)?chunk->liberties_black:chunk->liberties_white;
+
+                for(int i = 0; i < kBatchLanes; ++i)
+                {
+                    uint8_t a = (color0[i] == side)*label0[i];
+                    uint8_t b = (color1[i] == side)*label1[i];
+                    uint8_t c = (color2[i] == side)*label2[i];
+                    uint8_t d = (color3[i] == side)*label3[i];
+
+                    int distinct = (a != 0) +
+                        (b != 0 && b != a) +
+                        (c != 0 && c != a && c != b) +
+                        (d != 0 && d != a && d != b && d != c);
+
+                    liberties[i] += (color[i] == EMPTY)*distinct;
+                }
+            }
+        }
+    }
+
+    // Marks the empty points from which the side's
+    // stones can be reached through empty points.
+    void SpreadReach(int side, uint8_t reach[kNumPoints][kBatchLanes], Chunk *chunk)
+    {
+        for(int p = 0; p < kNumPoints; ++p)
+        {
+            const int *neighbors = kNeighbors.points[p];
+            const uint8_t *color = chunk->color[p];
+
+            const uint8_t *color0 = chunk->color[neighbors[0]];
+            const uint8_t *color1 = chunk->color[neighbors[1]];
+            const uint8_t *color2 = chunk->color[neighbors[2]];
+            const uint8_t *color3 = chunk->color[neighbors[3]];
+
+            for(int i = 0; i < kBatchLanes; ++i)
+            {
+                uint8_t next_to = (color0[i] == side) | (color1[i] == side) | (color2[i] == side) | (color3[i] == side);
+
+                reach[p][i] = (color[i] == EMPTY) & next_to;
+            }
+        }
+
+        bool changed = true;
+        for(int pass = 0; changed; ++pass)
+        {
+            changed = false;
+
+            for(int n = 0; n < kNumPoints; ++n)
+            {
+                int p = (pass % 2 == 0)?n:kNumPoints - 1 - n;
+                const int *neighbors = kNeighbors.points[p];
+                const uint8_t *color = chunk->color[p];
+
+                uint8_t *own = reach[p];
+                const uint8_t *reach0 = reach[neighbors[0]];
+                const uint8_t *reach1 = reach[neighbors[1]];
+                const uint8_t *reach2 = reach[neighbors[2]];
+                const uint8_t *reach3 = reach[neighbors[3]];
+
+                uint8_t lane_changed = 0;
+                for(int i = 0; i < kBatchLanes; ++i)
+                {
+                    uint8_t spread = (color[i] == EMPTY) & (reach0[i] | reach1[i] | reach2[i] | reach3[i]);
+
+                    lane_changed |= spread & ~own[i];
+                    own[i] |= spread;
+                }
+
+                changed |= (lane_changed != 0);
+            }
+        }
+    }
+
+    // An empty region is territory if it only
+    // borders stones of a single color, the same
+    // rule as Board::CalculateScore.
+    void CountTerritory(Chunk *chunk)
+    {
+        SpreadReach(BLACK, chunk->reach_black, chunk);
+        SpreadReach(WHITE, chunk->reach_white, chunk);
+
+        std::fill(chunk->territory_black, chunk->territory_black + kBatchLanes, 0);
+        std::fill(chunk->territory_white, chunk->territory_white + kBatchLanes, 0);
+
+        for(int p = 0; p < kNumPoints; ++p)
+        {
+            const uint8_t *black = chunk->reach_black[p];
+            const uint8_t *white = chunk->reach_white[p];
+
+            for(int i = 0; i < kBatchLanes; ++i)
+            {
+                chunk->territory_black[i] += black[i] & !white[i];
+                chunk->territory_white[i] += white[i] & !black[i];
+            }
+        }
+    }
+
+    // Adds the pass-alive areas like Board::CalculateScore
+    // does under Japanese rules. Benson's algorithm isn't
+    // vectorized, it runs on one lane at a time.
+    void AddSafeAreas(int lanes, Chunk *chunk)
+    {
+        int stones[kNumPoints];
+        SafeAreas safe;
+
+        for(int i = 0; i < lanes; ++i)
+        {
+            for(int p = 0; p < kNumPoints; ++p)
+                stones[p] = chunk->color[p][i];
+
+            FindSafeAreas(stones, &safe);
+
+            for(int p = 0; p < kNumPoints; ++p)
+            {
+                int owner = safe[p];
+                int stone = stones[p];
+                if(owner == EMPTY || stone == owner)
+                    continue;
+
+                // Empty points walled in by dead stones
+                // went to the other side.
+                bool black = chunk->reach_black[p][i] && !chunk->reach_white[p][i];
+                bool white = chunk->reach_white[p][i] && !chunk->reach_black[p][i];
+                if((owner == BLACK && black) || (owner == WHITE && white))
+                    continue;
+
+                chunk->territory_black[i] -= black;
+                chunk->territory_white[i] -= white;
+
+                int points = (stone == EMPTY)?1:2;
+                if(owner == WHITE)
+                    chunk->territory_white[i] += points;
+                else
+                    chunk->territory_black[i] += points;
+            }
+        }
+    }
+
+    int Sign(int value)
+    {
+        return (value > 0) - (value < 0);
+    }
+}
+
+void PositionBatch::Add(const Board& board)
+{
+    for(int y = 0; y < kBoardSize; ++y)
+    {
+        uint16_t black = 0;
+        uint16_t white = 0;
+
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            int stone = board.GetStone(x,y);
+            black |= (stone == BLACK) << x;
+            white |= (stone == WHITE) << x;
+        }
+
+        black_rows[y].push_back(black);
+        white_rows[y].push_back(white);
+    }
+
+    captures_black.push_back(board.GetCaptures(BLACK));
+    captures_white.push_back(board.GetCaptures(WHITE));
+}
+
+void PositionBatch::Clear()
+{
+    for(int y = 0; y < kBoardSize; ++y)
+    {
+        black_rows[y].clear();
+        white_rows[y].clear();
+    }
+
+    captures_black.clear();
+    captures_white.clear();
+}
+
+void GetBatchFeatures(const PositionBatch& batch, std::vector<EvaluationFeatures> *features, const Parameters& parameters)
+{
+    PROFILE_ZONE("GetBatchFeatures");
+
+    features->resize(batch.Size());
+
+    // About 30 kB, too much to keep on the stack of
+    // a search thread but fine to reuse per thread.
+    static thread_local Chunk chunk;
+
+    for(size_t first = 0; first < batch.Size(); first += kBatchLanes)
+    {
+        int lanes = static_cast<int>(std::min<size_t>(kBatchLanes, batch.Size() - first));
+
+        LoadChunk(batch, first, lanes, &chunk);
+        CalculateInfluence(parameters, &chunk);
+        LabelGroups(&chunk);
+        CountLiberties(&chunk);
+        CountTerritory(&chunk);
+        AddSafeAreas(lanes, &chunk);
+
+        for(int i = 0; i < lanes; ++i)
+        {
+            EvaluationFeatures& f = (*features)[first + i];
+            f.influence = Sign(chunk.influence[i]);
+            f.liberties = Sign(chunk.liberties_black[i] - chunk.liberties_white[i]);
+            f.captures = batch.captures_black[first + i] - batch.captures_white[first + i];
+            f.territory = chunk.territory_black[i] - chunk.territory_white[i];
+        }
+    }
+}
+
+void EvaluateBatch(const PositionBatch& batch, std::vector<float> *scores, const Parameters& parameters)
+{
+    std::vector<EvaluationFeatures> features;
+    GetBatchFeatures(batch, &features, parameters);
+
+    scores->resize(features.size());
+    for(size_t i = 0; i < features.size(); ++i)
+        (*scores)[i] = features[i].Score(parameters);
+}
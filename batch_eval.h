@@ -0,0 +1,46 @@
+#ifndef BATCH_EVAL_H
+#define BATCH_EVAL_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+#include "parameters.h"
+
+// Positions evaluated side by side. Every step of
+// the evaluation is done for all the lanes of a chunk
+// at once, so the inner loops run over positions and
+// compile to vector instructions.
+const int kBatchLanes = 64;
+
+// Many positions in structure of arrays layout.
+// Row y of position i is black_rows[y][i], with bit
+// x set if there is a black stone on (x,y).
+struct PositionBatch
+{
+    std::array<std::vector<uint16_t>,kBoardSize> black_rows;
+    std::array<std::vector<uint16_t>,kBoardSize> white_rows;
+
+    std::vector<int16_t> captures_black;
+    std::vector<int16_t> captures_white;
+
+    size_t Size() const { return captures_black.size(); }
+
+    // Packs the stones and captures of the board.
+    void Add(const Board& board);
+    void Clear();
+};
+
+// Gets the evaluation features of every position,
+// see Board::GetEvaluationFeatures.
+void GetBatchFeatures(const PositionBatch& batch, std::vector<EvaluationFeatures> *features, const Parameters& parameters = kDefaultParameters);
+
+// Scores every position of the batch like Board::Evaluate.
+// The results are the same as Evaluate gives right after
+// a move that captured nothing. After a capture the groups
+// of the board miss the liberties the capture freed, which
+// the batch counts.
+void EvaluateBatch(const PositionBatch& batch, std::vector<float> *scores, const Parameters& parameters = kDefaultParameters);
+
+#endif
@@ -0,0 +1,292 @@
+#include "benchmark.h"
+#include "ai.h"
+#include "batch_eval.h"
+#include "benson.h"
+#include "ladder.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+
+#ifdef GO_AI_COUNT_ALLOCATIONS
+
+// Count heap allocations so that the benchmarks can
+// report allocations per operation. This replaces the
+// global operator new, so it is only compiled in with
+// -DGO_AI_COUNT_ALLOCATIONS.
+static thread_local uint64_t allocation_count = 0;
+
+void* operator new(std::size_t size)
+{
+    ++allocation_count;
+
+    void *memory = std::malloc(size ? size : 1);
+    if(memory == nullptr)
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+const bool kCountAllocations = true;
+
+#else
+
+// Stays 0, allocations aren't reported.
+static const uint64_t allocation_count = 0;
+
+const bool kCountAllocations = false;
+
+#endif
+
+namespace
+{
+    // Every benchmark runs at least this long.
+    const double kMinBenchmarkSeconds = 0.2;
+
+    const uint32_t kCorpusSeed = 20240601;
+
+    struct BenchmarkResult
+    {
+        std::string name;
+        int ply;
+        uint64_t iterations;
+        double ns_per_op;
+        double allocations_per_op;
+    };
+
+    // Runs the operation in growing batches
+    // until kMinBenchmarkSeconds have passed.
+    BenchmarkResult Measure(const std::string& name, int ply, const std::function<void()>& operation)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        uint64_t iterations = 0;
+        uint64_t allocations = 0;
+        double seconds = 0;
+
+        uint64_t batch = 1;
+        while(seconds < kMinBenchmarkSeconds)
+        {
+            uint64_t allocations_before = allocation_count;
+            auto start = Clock::now();
+
+            for(uint64_t i = 0; i < batch; ++i)
+                operation();
+
+            seconds += std::chrono::duration<double>(Clock::now() - start).count();
+            allocations += allocation_count - allocations_before;
+            iterations += batch;
+
+            batch *= 2;
+        }
+
+        return {name, ply, iterations, seconds*1e9/iterations, static_cast<double>(allocations)/iterations};
+    }
+
+    void MakeUndoAllMoves(Board *board)
+    {
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            for(int y = 0; y < kBoardSize; ++y)
+            {
+                if(!board->Occupied({x,y}) && board->MakeMove({x,y}))
+                    board->UndoLastMove();
+            }
+        }
+    }
+
+    int CountEmptyPoints(const Board& board)
+    {
+        int empty = 0;
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            for(int y = 0; y < kBoardSize; ++y)
+            {
+                if(board.GetStone(x,y) == EMPTY)
+                    ++empty;
+            }
+        }
+        return empty;
+    }
+}
+
+void BenchmarkPositions(std::vector<Board> *positions)
+{
+    positions->clear();
+
+    // Play a single game with moves picked among the
+    // first few generated moves and take snapshots.
+    std::mt19937 rng(kCorpusSeed);
+    Board board;
+
+    for(int ply : kBenchmarkPlies)
+    {
+        while(board.GetMovesPlayed() < ply)
+        {
+            std::vector<Coordinate> moves;
+            board.GenerateMoves(&moves, board.GetSideToMove());
+
+            bool played = false;
+            for(int tries = 0; tries < 4 && !moves.empty() && !played; ++tries)
+            {
+                const Coordinate& move = moves[rng() % std::min<size_t>(moves.size(), 3)];
+                played = !board.Occupied(move) && board.MakeMove(move);
+            }
+
+            if(!played)
+                board.Pass();
+        }
+
+        positions->push_back(board);
+    }
+}
+
+bool RunBenchmarks(const std::string& output_path, int search_depth)
+{
+    std::vector<Board> positions;
+    BenchmarkPositions(&positions);
+
+    std::vector<BenchmarkResult> results;
+
+    for(size_t i = 0; i < positions.size(); ++i)
+    {
+        int ply = kBenchmarkPlies[i];
+        Board board = positions[i];
+
+        // One operation is a make and undo of every
+        // empty point, so report it per move instead.
+        BenchmarkResult make_undo = Measure("MakeMove+UndoLastMove", ply, [&]() { MakeUndoAllMoves(&board); });
+        int empty = std::max(1, CountEmptyPoints(board));
+        make_undo.ns_per_op /= empty;
+        make_undo.allocations_per_op /= empty;
+        results.push_back(make_undo);
+
+        results.push_back(Measure("CheckForCaptures", ply, [&]()
+        {
+            Move move;
+            board.CheckForCaptures(&move);
+        }));
+
+        results.push_back(Measure("GenerateMoves", ply, [&]()
+        {
+            std::vector<Coordinate> moves;
+            board.GenerateMoves(&moves, board.GetSideToMove());
+        }));
+
+        results.push_back(Measure("CalculateInfluence", ply, [&]() { board.CalculateInfluence(); }));
+        results.push_back(Measure("CalculateScore", ply, [&]() { board.CalculateScore(JAPANESE_RULES); }));
+        results.push_back(Measure("Evaluate", ply, [&]() { board.Evaluate(); }));
+
+        // Uncached, the board keeps the areas it found last.
+        SafeAreas safe_areas;
+        results.push_back(Measure("FindSafeAreas", ply, [&]() { FindSafeAreas(board, &safe_areas); }));
+
+        // Uncached reads of every ladder the ai would
+        // look at in the position.
+        LadderReader ladder_reader;
+        results.push_back(Measure("LadderReader", ply, [&]()
+        {
+            ladder_reader.ClearCache();
+            for(int side : {BLACK, WHITE})
+            {
+                for(int index : board.GetAtariGroups(side))
+                    ladder_reader.IsCaptured(board, board.GetGroups(side)[index].stones[0]);
+
+                for(int index : board.GetTwoLibertyGroups(side))
+                {
+                    const Group& group = board.GetGroups(side)[index];
+                    for(const Coordinate& atari : group.liberties)
+                        ladder_reader.AtariCaptures(board, group.stones[0], atari);
+                }
+            }
+        }));
+
+        // A full chunk of copies of the position,
+        // reported per position.
+        PositionBatch batch;
+        for(int lane = 0; lane < kBatchLanes; ++lane)
+            batch.Add(board);
+
+        std::vector<float> scores;
+        BenchmarkResult batch_result = Measure("EvaluateBatch", ply, [&]() { EvaluateBatch(batch, &scores); });
+        batch_result.ns_per_op /= kBatchLanes;
+        batch_result.allocations_per_op /= kBatchLanes;
+        results.push_back(batch_result);
+    }
+
+    std::ostringstream json;
+    json<<"{\n  \"benchmarks\": [\n";
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchmarkResult& r = results[i];
+        json<<"    {\"name\": \""<<r.name<<"\", \"ply\": "<<r.ply;
+        json<<", \"iterations\": "<<r.iterations;
+        json<<", \"ns_per_op\": "<<r.ns_per_op;
+        if(kCountAllocations)
+            json<<", \"allocations_per_op\": "<<r.allocations_per_op;
+        json<<"}";
+        json<<((i + 1 < results.size())?",\n":"\n");
+    }
+    json<<"  ],\n  \"search\": [\n";
+
+    // End to end searches, with progressive widening and with
+    // the fixed moves_to_consider cut that came before it. The
+    // opening position is skipped since the ai doesn't search it.
+    for(size_t i = 1; i < positions.size(); ++i)
+    {
+        for(int widening : {1, 0})
+        {
+            Board board = positions[i];
+
+            Parameters parameters;
+            parameters.search_depth = search_depth;
+            parameters.progressive_widening = widening;
+
+            Ai ai;
+            ai.SetVerbose(false);
+            ai.SetParameters(parameters);
+
+            auto start = std::chrono::steady_clock::now();
+
+            Coordinate best_move;
+            ai.GetBestMove(&board, &best_move);
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            uint64_t nodes = ai.GetNodesSearched();
+
+            json<<"    {\"name\": \""<<(widening?"GetBestMove":"GetBestMoveFixedWidth")<<"\", \"ply\": "<<kBenchmarkPlies[i];
+            json<<", \"depth\": "<<search_depth;
+            json<<", \"ms\": "<<seconds*1000;
+            json<<", \"nodes\": "<<nodes;
+            json<<", \"nodes_per_sec\": "<<((seconds > 0)?nodes/seconds:0)<<"}";
+            json<<((i + 1 < positions.size() || widening)?",\n":"\n");
+        }
+    }
+    json<<"  ]\n}\n";
+
+    if(output_path.empty())
+    {
+        std::cout<<json.str();
+        return true;
+    }
+
+    std::ofstream out(output_path);
+    out<<json.str();
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,25 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+// Plies of the benchmark positions, from the
+// opening to the endgame.
+const std::vector<int> kBenchmarkPlies = {0, 10, 25, 45, 70};
+
+// Builds the fixed benchmark corpus. The positions
+// are the same on every run and every platform.
+void BenchmarkPositions(std::vector<Board> *positions);
+
+// Runs the Board and Ai benchmarks and writes the
+// results as JSON to the given file, or to stdout if
+// the path is empty. Searches go to search_depth.
+// Returns false if the output couldn't be written.
+// Allocations per operation are only reported when
+// compiled with -DGO_AI_COUNT_ALLOCATIONS.
+bool RunBenchmarks(const std::string& output_path, int search_depth = 2);
+
+#endif
@@ -0,0 +1,224 @@
+#include "benson.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+    const int kNumPoints = kBoardSize*kBoardSize;
+
+    int Neighbors(int point, int *neighbors)
+    {
+        int x = point % kBoardSize;
+        int y = point / kBoardSize;
+
+        int count = 0;
+        if(x > 0)
+            neighbors[count++] = point - 1;
+        if(x < kBoardSize - 1)
+            neighbors[count++] = point + 1;
+        if(y > 0)
+            neighbors[count++] = point - kBoardSize;
+        if(y < kBoardSize - 1)
+            neighbors[count++] = point + kBoardSize;
+        return count;
+    }
+
+    // Labels the connected sets of points for which
+    // inside(point) is true. The points of label l are
+    // members[first[l]] to members[first[l+1]-1].
+    // Returns the number of labels.
+    template<typename F>
+    int Label(F inside, int *labels, int *members, int *first)
+    {
+        std::fill(labels, labels + kNumPoints, -1);
+
+        int nr_labels = 0;
+        int nr_members = 0;
+
+        for(int start = 0; start < kNumPoints; ++start)
+        {
+            if(labels[start] != -1 || !inside(start))
+                continue;
+
+            first[nr_labels] = nr_members;
+            labels[start] = nr_labels;
+            members[nr_members++] = start;
+
+            for(int i = first[nr_labels]; i < nr_members; ++i)
+            {
+                int neighbors[4];
+                int nr_neighbors = Neighbors(members[i], neighbors);
+                for(int j = 0; j < nr_neighbors; ++j)
+                {
+                    int n = neighbors[j];
+                    if(labels[n] == -1 && inside(n))
+                    {
+                        labels[n] = nr_labels;
+                        members[nr_members++] = n;
+                    }
+                }
+            }
+
+            ++nr_labels;
+        }
+
+        first[nr_labels] = nr_members;
+        return nr_labels;
+    }
+
+    // Sets of blocks are kept as bits. Blocks don't touch
+    // each other, so there are at most 41 on the board.
+    typedef uint64_t BlockSet;
+
+    void FindSafeAreasOfColor(const int *stones, int color, SafeAreas *areas)
+    {
+        int block_of[kNumPoints];
+        int block_points[kNumPoints];
+        int block_first[kNumPoints + 1];
+
+        int region_of[kNumPoints];
+        int region_points[kNumPoints];
+        int region_first[kNumPoints + 1];
+
+        int nr_blocks = Label([&](int p) { return stones[p] == color; }, block_of, block_points, block_first);
+        if(nr_blocks == 0)
+            return;
+
+        int nr_regions = Label([&](int p) { return stones[p] != color; }, region_of, region_points, region_first);
+
+        // The blocks next to each region and the ones it is
+        // vital to, i.e. the blocks next to every empty point.
+        // A small region has all its empty points next to
+        // the blocks.
+        BlockSet bordering[kNumPoints];
+        BlockSet vital_to[kNumPoints];
+        bool small[kNumPoints];
+
+        for(int r = 0; r < nr_regions; ++r)
+        {
+            bordering[r] = 0;
+            vital_to[r] = ~BlockSet(0);
+            small[r] = true;
+
+            bool has_empty = false;
+
+            for(int i = region_first[r]; i < region_first[r + 1]; ++i)
+            {
+                int p = region_points[i];
+
+                int neighbors[4];
+                int nr_neighbors = Neighbors(p, neighbors);
+
+                BlockSet adjacent = 0;
+                for(int j = 0; j < nr_neighbors; ++j)
+                {
+                    int block = block_of[neighbors[j]];
+                    if(block != -1)
+                        adjacent |= BlockSet(1) << block;
+                }
+
+                bordering[r] |= adjacent;
+
+                if(stones[p] != EMPTY)
+                    continue;
+
+                has_empty = true;
+                vital_to[r] &= adjacent;
+                if(adjacent == 0)
+                    small[r] = false;
+            }
+
+            // A region of only opponent stones gives no eye.
+            if(!has_empty)
+            {
+                vital_to[r] = 0;
+                small[r] = false;
+            }
+        }
+
+        BlockSet alive = (nr_blocks == 64)?~BlockSet(0):((BlockSet(1) << nr_blocks) - 1);
+        bool kept_region[kNumPoints];
+        std::fill(kept_region, kept_region + nr_regions, true);
+
+        bool changed = true;
+        while(changed)
+        {
+            changed = false;
+
+            // Blocks with one vital region so far and
+            // the ones with two or more.
+            BlockSet one = 0;
+            BlockSet two = 0;
+            for(int r = 0; r < nr_regions; ++r)
+            {
+                if(!kept_region[r])
+                    continue;
+
+                two |= one & vital_to[r];
+                one |= vital_to[r];
+            }
+
+            if((alive & ~two) != 0)
+            {
+                alive &= two;
+                changed = true;
+            }
+
+            for(int r = 0; r < nr_regions; ++r)
+            {
+                if(kept_region[r] && (bordering[r] & ~alive) != 0)
+                {
+                    kept_region[r] = false;
+                    changed = true;
+                }
+            }
+        }
+
+        if(alive == 0)
+            return;
+
+        for(int b = 0; b < nr_blocks; ++b)
+        {
+            if(!(alive & (BlockSet(1) << b)))
+                continue;
+
+            for(int i = block_first[b]; i < block_first[b + 1]; ++i)
+                (*areas)[block_points[i]] = color;
+        }
+
+        for(int r = 0; r < nr_regions; ++r)
+        {
+            if(!kept_region[r] || !small[r] || bordering[r] == 0)
+                continue;
+
+            for(int i = region_first[r]; i < region_first[r + 1]; ++i)
+                (*areas)[region_points[i]] = color;
+        }
+    }
+}
+
+void FindSafeAreas(const Board& board, SafeAreas *areas)
+{
+    PROFILE_ZONE("FindSafeAreas");
+
+    int stones[kNumPoints];
+    for(int p = 0; p < kNumPoints; ++p)
+    {
+        Coordinate c = Coordinate::Get2dCoordinate(p);
+        stones[p] = board.GetStone(c.x, c.y);
+    }
+
+    FindSafeAreas(stones, areas);
+}
+
+void FindSafeAreas(const int *stones, SafeAreas *areas)
+{
+    areas->fill(EMPTY);
+
+    // A point can't be safe for both colors, a pass-alive
+    // block never sits in the other color's territory.
+    FindSafeAreasOfColor(stones, BLACK, areas);
+    FindSafeAreasOfColor(stones, WHITE, areas);
+}
@@ -0,0 +1,32 @@
+#ifndef BENSON_H
+#define BENSON_H
+
+#include "board.h"
+
+// Benson's algorithm for unconditional life.
+//
+// For each color the stones are split into blocks and
+// the rest of the board into regions, the connected sets
+// of points without stones of the color. A region is vital
+// to a block if all of its empty points are liberties of
+// the block. Blocks with less than two vital regions are
+// dropped, then the regions next to dropped blocks, until
+// nothing changes. The blocks that are left are pass-alive:
+// the opponent can't capture them even if the color passes
+// every move.
+//
+// A region that is left and whose empty points all touch
+// the color's stones is pass-alive territory. The opponent
+// can't live there, so its stones there are dead.
+//
+// Fills areas with the color owning each point: a pass-alive
+// stone, a point of pass-alive territory or a dead stone in
+// it. EMPTY for points that aren't settled. Only the stones
+// are used, so the groups of the board may be stale.
+void FindSafeAreas(const Board& board, SafeAreas *areas);
+
+// The same for a bare position, stones[p] is the
+// color on point p indexed by Coordinate::As1D.
+void FindSafeAreas(const int *stones, SafeAreas *areas);
+
+#endif
@@ -1,70 +1,163 @@
 #include "board.h"
 #include "parameters.h"
 #include "util.h"
+#include "zobrist.h"
+#include "pattern.h"
+#include "benson.h"
+#include "profiler.h"
 #include <iostream>
 #include <algorithm>
 
-int Group::free_id = 0;
-
 Board::Board()
-{}
+{
+    for(int x = 0; x < kBoardSize; ++x)
+    {
+        for(int y = 0; y < kBoardSize; ++y)
+            pattern_codes[Coordinate{x,y}.As1D()] = Pattern::Compute(*this, {x,y});
+    }
+}
 
-int Board::LibertiesOfPoint(const Coordinate& c)
+void Board::UpdatePatterns(const Coordinate& c, int color)
 {
-    int liberties = 0;
-    if(c.x > 0)
+    for(int i = 0; i < 8; ++i)
     {
-        if(!Occupied({c.x-1,c.y})) ++liberties;
+        int x = c.x + Pattern::kNeighborX[i];
+        int y = c.y + Pattern::kNeighborY[i];
+        if(x < 0 || x >= kBoardSize || y < 0 || y >= kBoardSize)
+            continue;
+
+        int shift = 2*Pattern::Opposite(i);
+        uint16_t& code = pattern_codes[y*kBoardSize + x];
+        code = (code & ~(3 << shift)) | (color << shift);
     }
-    if(c.x < kBoardSize - 1)
+}
+
+void Board::PlaceStone(const Coordinate& c, int color)
+{
+    board_array[c.x][c.y] = color;
+    UpdatePatterns(c, color);
+
+    const uint64_t *keys = Zobrist::SymmetricStoneKeys(color, c.As1D());
+    for(int s = 0; s < kNumSymmetries; ++s)
+        stone_hashes[s] ^= keys[s];
+
+    if(network != nullptr)
+        network->AddStone(&accumulator, color, c.As1D());
+}
+
+void Board::RemoveStone(const Coordinate& c)
+{
+    const uint64_t *keys = Zobrist::SymmetricStoneKeys(board_array[c.x][c.y], c.As1D());
+    for(int s = 0; s < kNumSymmetries; ++s)
+        stone_hashes[s] ^= keys[s];
+
+    if(network != nullptr)
+        network->RemoveStone(&accumulator, board_array[c.x][c.y], c.As1D());
+
+    board_array[c.x][c.y] = EMPTY;
+    UpdatePatterns(c, EMPTY);
+}
+
+void Board::SetNetwork(const NnueNetwork *value)
+{
+    network = value;
+    if(network == nullptr)
+        return;
+
+    network->ResetAccumulator(&accumulator);
+    for(int x = 0; x < kBoardSize; ++x)
     {
-        if(!Occupied({c.x+1,c.y})) ++liberties;
+        for(int y = 0; y < kBoardSize; ++y)
+        {
+            if(board_array[x][y] != EMPTY)
+                network->AddStone(&accumulator, board_array[x][y], Coordinate{x,y}.As1D());
+        }
     }
-    if(c.y < kBoardSize - 1)
+}
+
+uint64_t Board::GetHash(int symmetry) const
+{
+    uint64_t hash = stone_hashes[symmetry];
+    if(side_to_play == WHITE)
+        hash ^= Zobrist::SideKey();
+
+    return hash;
+}
+
+uint64_t Board::GetCanonicalHash(int *symmetry) const
+{
+    uint64_t best = GetHash(0);
+    *symmetry = 0;
+
+    for(int s = 1; s < kNumSymmetries; ++s)
     {
-        if(!Occupied({c.x,c.y+1})) ++liberties;
+        uint64_t hash = GetHash(s);
+        if(hash < best)
+        {
+            best = hash;
+            *symmetry = s;
+        }
     }
-    if(c.y > 0)
+
+    return best;
+}
+
+int Board::NewGroupId()
+{
+    return ++free_group_id;
+}
+
+int Board::LibertiesOfPoint(const Coordinate& c)
+{
+    return Pattern::Liberties(Pattern::Properties(pattern_codes[c.As1D()]));
+}
+
+const SafeAreas& Board::GetSafeAreas()
+{
+    if(!safe_areas_valid || safe_areas_key != stone_hashes[0])
     {
-        if(!Occupied({c.x,c.y-1})) ++liberties;
+        FindSafeAreas(*this, &safe_areas);
+        safe_areas_key = stone_hashes[0];
+        safe_areas_valid = true;
     }
 
-    return liberties;
+    return safe_areas;
 }
 
-void Board::CalculateInfluence()
+void Board::CalculateInfluence(const Parameters& parameters)
 {
+    PROFILE_ZONE("Board::CalculateInfluence");
+
     for(int x = 0; x < kBoardSize; ++x)
     {
         for(int y = 0; y < kBoardSize; ++y)
         {
+            // Occupied points have no influence. They
+            // are cleared so that stones don't keep the
+            // value the point had before they were played.
             if(!Occupied({x,y}))
-                evaluation_array[x][y] = EvaluatePoint({x,y});
+                evaluation_array[x][y] = EvaluatePoint({x,y}, parameters);
+            else
+                evaluation_array[x][y] = 0;
         }
     }
 }
 
-float Board::Evaluate()
+void Board::GetEvaluationFeatures(EvaluationFeatures *features, const Parameters& parameters)
 {
-    CalculateInfluence();
+    CalculateInfluence(parameters);
     CalculateScore(JAPANESE_RULES);
 
-    float score = 0;
+    int influence = 0;
 
     for(int x = 0; x < kBoardSize; ++x)
     {
         for(int y = 0; y < kBoardSize; ++y)
         {
-            score += evaluation_array[x][y];
+            influence += evaluation_array[x][y];
         }
     }
 
-    if(score > 0)
-        score = kInfluenceWeight;
-    else if(score < 0)
-        score = -kInfluenceWeight;
-
-
     int liberties_white = 0;
     for(auto group : white_groups)
         liberties_white += group.liberties.size();
@@ -73,20 +166,20 @@ float Board::Evaluate()
     for(auto group : black_groups)
         liberties_black += group.liberties.size();
 
-    if(liberties_white > liberties_black)
-        score -= kLibertiesWeight;
-    else if(liberties_white < liberties_black)
-        score += kLibertiesWeight;
-
-    score -= captures_white*kCapturesWeight;
-    score += captures_black*kCapturesWeight;
+    features->influence = (influence > 0) - (influence < 0);
+    features->liberties = (liberties_black > liberties_white) - (liberties_black < liberties_white);
+    features->captures = captures_black - captures_white;
+    features->territory = territory_black - territory_white;
+}
 
-    score -= territory_white*kTerritoryWeight;
-    score += territory_black*kTerritoryWeight;
+float Board::Evaluate(const Parameters& parameters)
+{
+    PROFILE_ZONE("Board::Evaluate");
 
-    score -= kKomi;
+    EvaluationFeatures features;
+    GetEvaluationFeatures(&features, parameters);
 
-    return score;
+    return features.Score(parameters);
 }
 
 bool Board::Occupied(const Coordinate& c)
@@ -99,21 +192,21 @@ bool Board::OccupiedBy(const Coordinate& c, int side)
     return board_array[c.x][c.y] == side;
 }
 
-int Board::GetStone(int x, int y)
+int Board::GetStone(int x, int y) const
 {
     return board_array[x][y];
 }
 
-int Board::GetTerritory(int x, int y)
+int Board::GetTerritory(int x, int y) const
 {
     return territory_array[x][y];
 }
 
-int Board::EvaluatePoint(const Coordinate& c)
+int Board::EvaluatePoint(const Coordinate& c, const Parameters& parameters)
 {
     if(!Occupied(c))
     {
-        int weight = kPointEvaluation;
+        int weight = parameters.point_evaluation;
         int majority = 0;
         for(int i = -2; i < 3; ++i)
         {
@@ -124,11 +217,11 @@ int Board::EvaluatePoint(const Coordinate& c)
                     // Edge points are weighed more heavily.
                     if(c.x == 0 || c.x == 8 || c.y == 0 || c.y == 8)
                     {
-                        weight = kEdgePointEvaluation;
+                        weight = parameters.edge_point_evaluation;
                     }
                     else if(c.x == 1 || c.x == 7 || c.y == 1 || c.y == 7)
                     {
-                        weight = kEdgePointEvaluation;
+                        weight = parameters.edge_point_evaluation;
                     }
 
                     if(board_array[c.x+i][c.y+j] == BLACK)
@@ -163,6 +256,8 @@ bool Board::MakeMove(const Coordinate& c)
     current_move.point = c;
     current_move.ko_active = ko_active;
     current_move.ko_point = ko_point;
+    current_move.white_passed = white_passed;
+    current_move.black_passed = black_passed;
 
     if(ko_active)
     {
@@ -173,13 +268,15 @@ bool Board::MakeMove(const Coordinate& c)
     ko_active = false;
     ko_point = {-1,-1};
 
-    board_array[c.x][c.y] = side_to_play;
+    PlaceStone(c, side_to_play);
 
     if(!CheckForCaptures(&current_move))
     {
         // Suicide rule has been violated.
-        // Undo the move.
-        board_array[c.x][c.y] = EMPTY;
+        // Undo the move, the ko ban included.
+        RemoveStone(c);
+        ko_active = current_move.ko_active;
+        ko_point = current_move.ko_point;
         //std::cout<<"Suicide rule or ko rule was violated.\n";
         return false;
     }
@@ -210,7 +307,21 @@ void Board::UndoLastMove()
 
     Move& played_move = played_moves.back();
 
-    board_array[played_move.point.x][played_move.point.y] = EMPTY;
+    white_passed = played_move.white_passed;
+    black_passed = played_move.black_passed;
+
+    if(played_move.point == kPassMove)
+    {
+        ko_active = played_move.ko_active;
+        ko_point = played_move.ko_point;
+        side_to_play = OppositeSide(side_to_play);
+
+        played_moves.pop_back();
+        --moves_played;
+        return;
+    }
+
+    RemoveStone(played_move.point);
 
     if(played_move.captured_groups.size() > 0) 
     {
@@ -220,7 +331,7 @@ void Board::UndoLastMove()
         {
             for(auto stone : group.stones)
             {
-                board_array[stone.x][stone.y] = side_to_play;
+                PlaceStone(stone, side_to_play);
             }
         }
     }
@@ -260,21 +371,33 @@ void Board::AddCaptures(int side, int amount)
 
 void Board::AddMovesOnGroupLiberties(std::vector<Coordinate> *moves, std::unordered_set<int> *added_moves_set, int side, int liberties)
 {
-    std::vector<Group>& all_groups = (side == WHITE)?white_groups:black_groups;
+    const std::vector<Group>& all_groups = (side == WHITE)?white_groups:black_groups;
 
-    for(auto group : all_groups)
+    auto add_liberties = [&](const Group& group)
     {
-        if(group.liberties.size() == liberties)
+        for(const Coordinate& liberty : group.liberties)
         {
-            for(auto liberty : group.liberties)
+            if(!Occupied(liberty) && !Util::set_contains<int>(added_moves_set,liberty.As1D()))
             {
-                if(!Occupied(liberty) && !Util::set_contains<int>(added_moves_set,liberty.As1D()))
-                {
-                    moves->push_back(liberty);
-                    added_moves_set->insert(liberty.As1D());
-                }
+                moves->push_back(liberty);
+                added_moves_set->insert(liberty.As1D());
             }
         }
+    };
+
+    // The common cases come straight from the index.
+    if(liberties == 1 || liberties == 2)
+    {
+        const std::vector<int>& indices = (liberties == 1)?atari_groups[side]:two_liberty_groups[side];
+        for(int index : indices)
+            add_liberties(all_groups[index]);
+        return;
+    }
+
+    for(const Group& group : all_groups)
+    {
+        if(static_cast<int>(group.liberties.size()) == liberties)
+            add_liberties(group);
     }
 }
 
@@ -330,31 +453,25 @@ void Board::AddMovesInList(std::vector<Coordinate> *moves, std::unordered_set<in
 
 void Board::AddMovesThatConnectTwoGroups(std::vector<Coordinate> *moves, std::unordered_set<int> *added_moves_set, int side)
 {
-    std::vector<Group>& groups = (side == WHITE)?white_groups:black_groups;
-
-    // Connect groups.
-    for(auto g1 : groups)
+    // Connect groups. Any empty point that is a
+    // liberty of two or more groups connects them.
+    for(int x = 0; x < kBoardSize; ++x)
     {
-        for(auto g2 : groups)
+        for(int y = 0; y < kBoardSize; ++y)
         {
-            if(g1 == g2) continue;
+            Coordinate c = {x,y};
 
-            for(auto l1 : g1.liberties)
-            {
-                // Don't play on your own territory unless you have to.
-                if(territory_array[l1.x][l1.y] == side)
-                    continue;
+            // Don't play on your own territory unless you have to.
+            if(territory_array[x][y] == side)
+                continue;
 
-                for(auto l2 : g2.liberties)
-                {
-                    if(l1 == l2 && !Util::set_contains<int>(added_moves_set,l1.As1D()))
-                    {
-                        moves->push_back(l1);
-                        added_moves_set->insert(l1.As1D());
-                    }
-                }
+            // The index is stale after an undo or a pass,
+            // so check the point too.
+            if(adjacent_groups[side][c.As1D()].count >= 2 && !Occupied(c) && !Util::set_contains<int>(added_moves_set,c.As1D()))
+            {
+                moves->push_back(c);
+                added_moves_set->insert(c.As1D());
             }
-
         }
     }
 }
@@ -373,18 +490,15 @@ void Board::AddMovesThatExtendYourInfluence(std::vector<Coordinate> *moves, std:
         {
             if(!Occupied({x,y}))
             {
-                if((x == 0 && y == 0) || (x == 0 && y == 8) || (x == 8 && y == 8) || (x == 8 && y ==0))
-                {
-                    // Avoid playing the corner point for no good reason.
-                    if(LibertiesOfPoint({x,y}) == 2) 
-                        continue;
-                }
-                if(x == 0 || y == 0 || x == 8 || y == 8)
-                {
-                    // Avoid playing the edge points for no good reason.
-                    if(LibertiesOfPoint({x,y}) == 3) 
-                        continue;
-                }
+                uint16_t properties = Pattern::Properties(pattern_codes[Coordinate{x,y}.As1D()]);
+
+                // Avoid playing the corner point for no good reason.
+                if((properties & PATTERN_CORNER_POINT) && Pattern::Liberties(properties) == 2)
+                    continue;
+
+                // Avoid playing the edge points for no good reason.
+                if((properties & PATTERN_EDGE_POINT) && Pattern::Liberties(properties) == 3)
+                    continue;
 
                 // Don't play on your own territory unless you have to.
                 if(territory_array[x][y] == side)
@@ -445,100 +559,43 @@ void Board::AddMovesThatExtendYourInfluence(std::vector<Coordinate> *moves, std:
 
 void Board::AddMovesThatConnectGroupToEdge(std::vector<Coordinate> *moves, std::unordered_set<int> *added_moves_set, int side)
 {
-    for(int x = 1; x < kBoardSize - 1; ++x)
+    // Empty edge points with a stone of the side on
+    // one of the three points next to them on the
+    // second line. Corners are left out.
+    uint16_t connects = Pattern::SecondLineProperty(side);
+
+    auto add_if_connecting = [&](const Coordinate& c)
     {
-        Coordinate c1 = {x,0};
-        Coordinate c2 = {x,8};
+        if(Occupied(c) || Util::set_contains<int>(added_moves_set, c.As1D()))
+            return;
 
-        if(!Occupied({x,0}) && !Util::set_contains<int>(added_moves_set, c1.As1D())) 
+        if(Pattern::Properties(pattern_codes[c.As1D()]) & connects)
         {
-            if(OccupiedBy({x,1},side))
-            {
-                moves->push_back(c1);
-                added_moves_set->insert(c1.As1D());
-            }
-            if(OccupiedBy({x+1,1},side))
-            {
-                moves->push_back(c1);
-                added_moves_set->insert(c1.As1D());
-            }
-            if(OccupiedBy({x-1,1},side))
-            {
-                moves->push_back(c1);
-                added_moves_set->insert(c1.As1D());
-            }
+            moves->push_back(c);
+            added_moves_set->insert(c.As1D());
         }
+    };
 
-        if(!Occupied(c2) && !Util::set_contains<int>(added_moves_set, c2.As1D())) 
-        {
-            if(OccupiedBy({x,7},side))
-            {
-                moves->push_back(c2);
-                added_moves_set->insert(c2.As1D());
-            }
-            if(OccupiedBy({x+1,7},side))
-            {
-                moves->push_back(c2);
-                added_moves_set->insert(c2.As1D());
-            }
-            if(OccupiedBy({x-1,7},side))
-            {
-                moves->push_back(c2);
-                added_moves_set->insert(c2.As1D());
-            }
-        }
+    for(int x = 1; x < kBoardSize - 1; ++x)
+    {
+        add_if_connecting({x,0});
+        add_if_connecting({x,kBoardSize - 1});
     }
 
     for(int y = 1; y < kBoardSize - 1; ++y)
     {
-        Coordinate c1 = {0,y};
-        Coordinate c2 = {8,y};
-
-        if(!Occupied(c1) && !Util::set_contains<int>(added_moves_set, c1.As1D())) 
-        {
-            if(OccupiedBy({1,y},side))
-            {
-                moves->push_back(c1);
-                added_moves_set->insert(c1.As1D());
-            }
-            if(OccupiedBy({1,y+1},side))
-            {
-                moves->push_back(c1);
-                added_moves_set->insert(c1.As1D());
-            }
-            if(OccupiedBy({1,y-11},side))
-            {
-                moves->push_back(c1);
-                added_moves_set->insert(c1.As1D());
-            }
-        }
-
-        if(!Occupied(c2) && !Util::set_contains<int>(added_moves_set, c2.As1D())) 
-        {
-            if(OccupiedBy({7,y},side))
-            {
-                moves->push_back(c2);
-                added_moves_set->insert(c2.As1D());
-            }
-            if(OccupiedBy({7,y+1},side))
-            {
-                moves->push_back(c2);
-                added_moves_set->insert(c2.As1D());
-            }
-            if(OccupiedBy({7,y-1},side))
-            {
-                moves->push_back(c2);
-                added_moves_set->insert(c2.As1D());
-            }
-        }
+        add_if_connecting({0,y});
+        add_if_connecting({kBoardSize - 1,y});
     }
 }
 
-void Board::GenerateMoves(std::vector<Coordinate> *moves, int side)
+void Board::GenerateMoves(std::vector<Coordinate> *moves, int side, const Parameters& parameters)
 {
+    PROFILE_ZONE("Board::GenerateMoves");
+
     int opponent_side = OppositeSide(side);
 
-    CalculateInfluence();
+    CalculateInfluence(parameters);
 
     // Keep track of already_added_moves.
     std::unordered_set<int> added_moves_set;
@@ -576,6 +633,11 @@ void Board::GenerateMoves(std::vector<Coordinate> *moves, int side)
     // Try to stay connected.
     AddMovesThatConnectTwoGroups(moves, &added_moves_set, side);
 
+    // Nothing played inside pass-alive areas
+    // changes who owns them.
+    const SafeAreas& safe = GetSafeAreas();
+    moves->erase(std::remove_if(moves->begin(), moves->end(), [&](const Coordinate& c) { return safe[c.As1D()] != EMPTY; }), moves->end());
+
     // If nothing else, generate all the remaining moves. 
     //GenerateRandomMoves(moves, &added_moves_set);
 }
@@ -598,8 +660,20 @@ void Board::GenerateRandomMoves(std::vector<Coordinate> *moves, std::unordered_s
 
 bool Board::CheckForCaptures(Move *current_move)
 {
+    PROFILE_ZONE("Board::CheckForCaptures");
+
     white_groups.clear();
     black_groups.clear();
+    free_group_id = 0;
+
+    for(int side : {BLACK, WHITE})
+    {
+        atari_groups[side].clear();
+        two_liberty_groups[side].clear();
+
+        for(AdjacentGroups& adjacent : adjacent_groups[side])
+            adjacent.count = 0;
+    }
 
     int side_to_check = OppositeSide(side_to_play);
 
@@ -718,13 +792,14 @@ bool Board::CheckForCaptures(Move *current_move)
                     }
 
                     Group captured_group;
+                    captured_group.id = NewGroupId();
                     captured_group.stones = potential_captures;
                     
                     current_move->captured_groups.push_back(captured_group);
                     current_move->nr_captured_stones += potential_captures.size();
 
                     for(auto c : potential_captures) 
-                        board_array[c.x][c.y] = EMPTY;
+                        RemoveStone(c);
 
                     possible_suicide = false;
 
@@ -732,14 +807,29 @@ bool Board::CheckForCaptures(Move *current_move)
                 else
                 {
                     Group new_group; 
+                    new_group.id = NewGroupId();
                     new_group.stones = potential_captures;
                     new_group.liberties = liberties;
 
                     // Update group vectors for alive groups.
-                    if(board_array[x][y] == WHITE)
-                        white_groups.push_back(new_group);
-                    else
-                        black_groups.push_back(new_group);
+                    int side = board_array[x][y];
+                    std::vector<Group>& groups = (side == WHITE)?white_groups:black_groups;
+                    int index = static_cast<int>(groups.size());
+
+                    if(liberties.size() == 1)
+                        atari_groups[side].push_back(index);
+                    else if(liberties.size() == 2)
+                        two_liberty_groups[side].push_back(index);
+
+                    // The liberties are distinct, so a group is
+                    // added at most once to each point.
+                    for(const Coordinate& liberty : liberties)
+                    {
+                        AdjacentGroups& adjacent = adjacent_groups[side][liberty.As1D()];
+                        adjacent.groups[adjacent.count++] = static_cast<uint8_t>(index);
+                    }
+
+                    groups.push_back(new_group);
 
                 }
             }
@@ -788,6 +878,8 @@ void Board::ResetScores()
 
 void Board::CalculateScore(int rules)
 {
+    PROFILE_ZONE("Board::CalculateScore");
+
     ResetScores();
 
     // This is basically the same algorithm
@@ -875,10 +967,50 @@ void Board::CalculateScore(int rules)
         }
     }
 
+    // Pass-alive territory is counted even where the flood
+    // fill above runs into dead stones. A dead stone counts
+    // as a point and, under Japanese rules, a prisoner.
+    const SafeAreas& safe = GetSafeAreas();
+    for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+    {
+        int owner = safe[i];
+        Coordinate c = Coordinate::Get2dCoordinate(i);
+        int stone = board_array[c.x][c.y];
+
+        if(owner == EMPTY || stone == owner || territory_array[c.x][c.y] == owner)
+            continue;
+
+        // Empty points walled in by dead stones went
+        // to the other side.
+        int counted = territory_array[c.x][c.y];
+        if(counted == WHITE)
+            --territory_white;
+        else if(counted == BLACK)
+            --territory_black;
+
+        int points = (stone == EMPTY || rules != JAPANESE_RULES)?1:2;
+        if(owner == WHITE)
+            territory_white += points;
+        else
+            territory_black += points;
+
+        territory_array[c.x][c.y] = owner;
+    }
 }
 
 void Board::Pass()
 {
+    Move current_move;
+    current_move.point = kPassMove;
+    current_move.ko_active = ko_active;
+    current_move.ko_point = ko_point;
+    current_move.white_passed = white_passed;
+    current_move.black_passed = black_passed;
+
+    // The ko ban only lasts for a single move.
+    ko_active = false;
+    ko_point = {-1,-1};
+
     if(side_to_play == WHITE)
     {
         side_to_play = BLACK;
@@ -890,6 +1022,24 @@ void Board::Pass()
         black_passed = true;
     }
 
+    played_moves.push_back(current_move);
+    ++moves_played;
+}
+
+bool Board::GetLastMove(Coordinate *move) const
+{
+    if(played_moves.empty())
+        return false;
+
+    *move = played_moves.back().point;
+    return true;
+}
+
+void Board::GetMoveHistory(std::vector<Coordinate> *moves) const
+{
+    moves->clear();
+    for(const Move& move : played_moves)
+        moves->push_back(move.point);
 }
 
 void Board::Print()
@@ -1005,7 +1155,29 @@ void Board::PrintEndScreen()
     }
 }
 
+bool Board::GetKoPoint(Coordinate *point) const
+{
+    if(!ko_active)
+        return false;
+
+    *point = ko_point;
+    return true;
+}
+
 bool Board::EndGame()
 {
     return white_passed && black_passed;
 }
+
+void Board::RemoveDeadStones(const std::vector<Coordinate>& stones)
+{
+    for(const Coordinate& c : stones)
+    {
+        int color = board_array[c.x][c.y];
+        if(color == EMPTY)
+            continue;
+
+        RemoveStone(c);
+        AddCaptures(OppositeSide(color), 1);
+    }
+}
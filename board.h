@@ -2,15 +2,20 @@
 #define BOARD_H
 
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <unordered_set>
 #include <string>
 
+#include "nnue.h"
 #include "parameters.h"
 
 const int kBoardSize = 9;
 const float kKomi = 6.5;
 
+// The 8 rotations and reflections of the board.
+const int kNumSymmetries = 8;
+
 enum Color 
 {
     EMPTY = 0,
@@ -36,7 +41,7 @@ struct Coordinate
     int x;
     int y; 
 
-    bool operator==(const Coordinate& other)
+    bool operator==(const Coordinate& other) const
     {
         return other.x == x && other.y == y;
     }
@@ -48,30 +53,43 @@ struct Coordinate
     };
 };
 
+// The point used for passes in move histories.
+const Coordinate kPassMove = {-1,-1};
+
 const std::vector<Coordinate> kStarpoints = {{2,2},{6,2},{2,6},{6,6}};
 const std::vector<Coordinate> kSides = {{4,2},{2,4},{6,4},{4,6},{4,4},{4,5},{5,4},{5,5}};
 
 struct Group
 {
-    int id;
-    static int free_id;
-
-    Group()
-    {
-        id = ++free_id;
-    }
+    // Ids are handed out by the board that owns
+    // the group, see Board::NewGroupId. They are
+    // only unique within a single board.
+    int id = 0;
 
     std::vector<Coordinate> stones;
     std::vector<Coordinate> liberties;
 
-    bool operator==(const Group& other)
+    bool operator==(const Group& other) const
     {
-        return id = other.id;
+        return id == other.id;
     }
 };
 
+// The distinct groups of one color next to an empty
+// point, as indices into Board::GetGroups.
+struct AdjacentGroups
+{
+    std::array<uint8_t,4> groups;
+    uint8_t count = 0;
+};
+
+// For every point the color that owns it for good, see
+// benson.h, or EMPTY. Indexed by Coordinate::As1D.
+typedef std::array<int8_t,kBoardSize*kBoardSize> SafeAreas;
+
 struct Move
 {
+    // kPassMove for passes.
     Coordinate point;
     std::vector<Group> captured_groups;
 
@@ -84,6 +102,28 @@ struct Move
     bool black_passed;
 };
 
+// The terms of Board::Evaluate. The evaluation is
+// linear in the weights, so a position can be scored
+// with any weights once its features are known.
+struct EvaluationFeatures
+{
+    // Signs of the influence and liberty balance.
+    float influence = 0;
+    float liberties = 0;
+
+    // Black minus white.
+    float captures = 0;
+    float territory = 0;
+
+    float Score(const Parameters& parameters) const
+    {
+        return influence*parameters.influence_weight +
+            liberties*parameters.liberties_weight +
+            captures*parameters.captures_weight +
+            territory*parameters.territory_weight - kKomi;
+    }
+};
+
 class Board
 {
 
@@ -113,7 +153,8 @@ public:
     // I try to order the list from the 
     // move with the highest priority
     // to the one with the lowest priority.
-    void GenerateMoves(std::vector<Coordinate> *moves, int side);
+    // The influence is found with the given parameters.
+    void GenerateMoves(std::vector<Coordinate> *moves, int side, const Parameters& parameters = kDefaultParameters);
 
     // Adds the moves given in the new_moves list.
     void AddMovesInList(std::vector<Coordinate> *moves, std::unordered_set<int> *added_moves_set, std::vector<Coordinate> new_moves, int side, bool play_on_own_territory = false, bool play_on_opponents_influence = false, bool play_on_own_influence = false);
@@ -142,23 +183,49 @@ public:
     // current board position. A positive score
     // is in black's favor and a negative one 
     // in white's favor.
-    float Evaluate();
+    float Evaluate(const Parameters& parameters = kDefaultParameters);
+
+    // Gets the terms that Evaluate weighs. The
+    // point weights of the parameters are used
+    // for the influence.
+    void GetEvaluationFeatures(EvaluationFeatures *features, const Parameters& parameters = kDefaultParameters);
 
     // Calculates an evaluation score
     // on which side has the most influence on
     // a given point. A positive score is good
     // for black and a negative one is good for
     // white.
-    int EvaluatePoint(const Coordinate& c);
+    int EvaluatePoint(const Coordinate& c, const Parameters& parameters = kDefaultParameters);
 
-    void CalculateInfluence();
+    void CalculateInfluence(const Parameters& parameters = kDefaultParameters);
 
     // Passes for the currently moving side.
+    // A pass is kept in the move history and
+    // can be undone like any other move.
     void Pass();
 
+    // Gets the latest move, kPassMove for a pass.
+    // Returns false if no moves have been played.
+    bool GetLastMove(Coordinate *move) const;
+
+    // The played moves from the first one to the
+    // latest one. Passes are given as kPassMove.
+    void GetMoveHistory(std::vector<Coordinate> *moves) const;
+
+    // Gets the point that can't be played because
+    // of the ko rule. Returns false if there is none.
+    bool GetKoPoint(Coordinate *point) const;
+
     // Returns true if both sides have passed.
     bool EndGame();
 
+    // Takes the stones off the board as prisoners of
+    // the opponent, see ownership.h for finding dead
+    // stones. Meant for scoring a finished game, the
+    // removal is not kept in the move history and the
+    // groups are not rebuilt.
+    void RemoveDeadStones(const std::vector<Coordinate>& stones);
+
     // TODO: I think a flood fill algorithm
     // could be abstracted away for CheckForCaptures
     // and CalculateScore somehow and have these
@@ -179,15 +246,65 @@ public:
 
     // Get stone at a point.
     // Returns WHITE, BLACK or EMPTY.
-    int GetStone(int x, int y);
+    int GetStone(int x, int y) const;
 
     // Get territory at a point.
     // Returns WHITE, BLACK or EMPTY.
-    int GetTerritory(int x, int y);
+    int GetTerritory(int x, int y) const;
+
+    // Territory from the latest CalculateScore
+    // and captured stones for the given side.
+    int GetTerritoryCount(int side) const { return (side == WHITE)?territory_white:territory_black; }
+    int GetCaptures(int side) const { return (side == WHITE)?captures_white:captures_black; }
+
+    // The groups found by the latest move.
+    const std::vector<Group>& GetGroups(int side) const { return (side == WHITE)?white_groups:black_groups; }
+
+    // Indices into GetGroups(side) of the groups with one
+    // liberty and with two liberties. They are built
+    // together with the groups.
+    const std::vector<int>& GetAtariGroups(int side) const { return atari_groups[side]; }
+    const std::vector<int>& GetTwoLibertyGroups(int side) const { return two_liberty_groups[side]; }
+
+    // The groups of the given side that have the point as
+    // a liberty. Found by the latest move like GetGroups, so
+    // after an undo or a pass the point may be occupied.
+    const AdjacentGroups& GetAdjacentGroups(const Coordinate& c, int side) const { return adjacent_groups[side][c.As1D()]; }
+
+    // The pass-alive stones and territory of both sides.
+    // Found again only when the stones have changed.
+    const SafeAreas& GetSafeAreas();
 
     // Counts the liberties of a single point.
     int LibertiesOfPoint(const Coordinate& c);
 
+    // The 3x3 pattern code around a point, see pattern.h.
+    // Codes are kept up to date for all points as stones
+    // are placed and removed.
+    uint16_t GetPattern(const Coordinate& c) const { return pattern_codes[c.As1D()]; }
+
+    // Zobrist hash of the position as seen through
+    // one of the 8 symmetries, see symmetry.h.
+    // Symmetry 0 is the position as it is.
+    uint64_t GetHash(int symmetry = 0) const;
+
+    // Returns the smallest hash over all symmetries
+    // and the symmetry that produced it. Positions that
+    // are rotations or reflections of each other have
+    // the same canonical hash.
+    uint64_t GetCanonicalHash(int *symmetry) const;
+
+    // Keeps the accumulator of the network up to
+    // date from now on. The network has to outlive
+    // the board. Pass nullptr to stop.
+    void SetNetwork(const NnueNetwork *value);
+    const NnueNetwork* GetNetwork() const { return network; }
+
+    // Evaluates the position with the network,
+    // which has to be set. Same sign convention
+    // as Evaluate.
+    float EvaluateNetwork() const { return network->Evaluate(accumulator); }
+
     inline int GetSideToMove() const { return side_to_play;}
     inline int GetMovesPlayed() const { return moves_played;}
 
@@ -209,6 +326,17 @@ public:
 private:
     void UpdateWhosTerritory(int value, int *whos_territory);
 
+    // All stones are added and removed through these
+    // so that the hash keys stay up to date.
+    void PlaceStone(const Coordinate& c, int color);
+    void RemoveStone(const Coordinate& c);
+
+    // Sets the color of c in the patterns of its neighbors.
+    void UpdatePatterns(const Coordinate& c, int color);
+
+    // Returns the next free group id of this board.
+    int NewGroupId();
+
     // A stack to keep track of played moves
     // with information of captured groups.
     // This is needed for undoing moves.
@@ -233,9 +361,35 @@ private:
 
     int side_to_play = BLACK;
 
+    // Hash keys of the stones on the board for each
+    // symmetry. The side to move is added in GetHash.
+    std::array<uint64_t,kNumSymmetries> stone_hashes = {{0}};
+
+    std::array<uint16_t,kBoardSize*kBoardSize> pattern_codes;
+
+    // First layer sums of the network for the stones
+    // on the board, updated with the hashes.
+    const NnueNetwork *network = nullptr;
+    NnueAccumulator accumulator;
+
     std::vector<Group> white_groups;
     std::vector<Group> black_groups;
 
+    // Indexed by color.
+    std::array<std::vector<int>,NUM_COLORS> atari_groups;
+    std::array<std::vector<int>,NUM_COLORS> two_liberty_groups;
+    std::array<std::array<AdjacentGroups,kBoardSize*kBoardSize>,NUM_COLORS> adjacent_groups;
+
+    // Cached by the stone hash of the position they were found for.
+    SafeAreas safe_areas;
+    uint64_t safe_areas_key = 0;
+    bool safe_areas_valid = false;
+
+    // Group ids are local to the board so that
+    // boards on different threads share no state.
+    // The pool is reset whenever the groups are rebuilt.
+    int free_group_id = 0;
+
     // Internal arrays keeping track of occupied 
     // points, territory and evaluation.
     std::array<std::array<int,kBoardSize>,kBoardSize> board_array = {{EMPTY}};
@@ -0,0 +1,91 @@
+#include "concurrency.h"
+#include "game_record.h"
+#include "parameters.h"
+#include "self_play.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Returns an empty string if the records agree.
+    std::string Compare(const GameRecord& expected, const GameRecord& played)
+    {
+        if(expected.moves.size() != played.moves.size())
+            return "played " + std::to_string(played.moves.size()) + " moves instead of " + std::to_string(expected.moves.size());
+
+        for(size_t i = 0; i < expected.moves.size(); ++i)
+        {
+            if(!(expected.moves[i] == played.moves[i]))
+                return "move " + std::to_string(i) + " differs";
+        }
+
+        if(expected.winner != played.winner || expected.score != played.score)
+            return "result differs";
+
+        return "";
+    }
+}
+
+ConcurrencyResult RunConcurrencyTest(const ConcurrencyOptions& options)
+{
+    ConcurrencyResult result;
+    result.games = options.games;
+
+    auto start = std::chrono::steady_clock::now();
+
+    Parameters parameters;
+    parameters.search_depth = options.search_depth;
+
+    SelfPlayOptions self_play;
+    self_play.max_moves = options.max_moves;
+
+    std::vector<GameRecord> expected(options.games);
+    for(int game = 0; game < options.games; ++game)
+        PlaySelfPlayGame(parameters, parameters, options.seed + game, self_play, &expected[game]);
+
+    // The threads wait for each other so
+    // that all the games really overlap.
+    std::mutex mutex;
+    std::condition_variable ready;
+    int waiting = 0;
+
+    std::vector<std::string> mismatches(options.games);
+
+    auto play = [&](int game)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if(++waiting == options.games)
+                ready.notify_all();
+            else
+                ready.wait(lock, [&]() { return waiting == options.games; });
+        }
+
+        GameRecord record;
+        PlaySelfPlayGame(parameters, parameters, options.seed + game, self_play, &record);
+        mismatches[game] = Compare(expected[game], record);
+    };
+
+    std::vector<std::thread> threads;
+    for(int game = 0; game < options.games; ++game)
+        threads.emplace_back(play, game);
+
+    for(auto& thread : threads)
+        thread.join();
+
+    for(int game = 0; game < options.games; ++game)
+    {
+        if(mismatches[game].empty())
+            continue;
+
+        if(result.mismatches++ == 0)
+            result.first_mismatch = "game " + std::to_string(game) + ": " + mismatches[game];
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,41 @@
+#ifndef CONCURRENCY_H
+#define CONCURRENCY_H
+
+#include <cstdint>
+#include <string>
+
+// Checks that games on different threads don't share state.
+//
+// Every game is first played alone. Then all of them are
+// played again at the same time, each on a thread of its
+// own with its own Board and Ai objects, and every game has
+// to repeat its moves and result exactly.
+//
+// A wrong result catches shared state that changes moves.
+// Races that don't change any move are left to the thread
+// sanitizer. Build with it and run the check:
+//
+//     g++ -std=c++17 -g -O1 -fsanitize=thread -pthread *.cc `sdl2-config --cflags --libs` -o go-ai-tsan
+//     ./go-ai-tsan --concurrency 200
+
+struct ConcurrencyOptions
+{
+    int games = 200;
+    int max_moves = 30;
+    int search_depth = 1;
+    uint32_t seed = 1;
+};
+
+struct ConcurrencyResult
+{
+    int games = 0;
+    int mismatches = 0;
+    double seconds = 0;
+
+    // Description of the first mismatch found.
+    std::string first_mismatch;
+};
+
+ConcurrencyResult RunConcurrencyTest(const ConcurrencyOptions& options);
+
+#endif
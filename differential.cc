@@ -0,0 +1,451 @@
+#include "differential.h"
+#include "board.h"
+#include "reference_board.h"
+#include "pattern.h"
+#include "benson.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // A group as sorted stones and liberties,
+    // so that groups can be compared in any order.
+    typedef std::pair<std::vector<int>, std::vector<int>> GroupShape;
+
+    std::vector<GroupShape> GroupShapes(const std::vector<Group>& groups)
+    {
+        std::vector<GroupShape> shapes;
+        for(const Group& group : groups)
+        {
+            GroupShape shape;
+            for(const Coordinate& c : group.stones)
+                shape.first.push_back(c.As1D());
+            for(const Coordinate& c : group.liberties)
+                shape.second.push_back(c.As1D());
+
+            std::sort(shape.first.begin(), shape.first.end());
+            std::sort(shape.second.begin(), shape.second.end());
+            shapes.push_back(shape);
+        }
+
+        std::sort(shapes.begin(), shapes.end());
+        return shapes;
+    }
+
+    // Returns an empty string if the boards agree.
+    // Groups are only rebuilt by moves, so they are
+    // only compared when check_groups is set.
+    std::string Compare(Board *board, ReferenceBoard *reference, bool check_groups)
+    {
+        if(board->GetSideToMove() != reference->GetSideToMove())
+            return "side to move differs";
+
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            for(int y = 0; y < kBoardSize; ++y)
+            {
+                if(board->GetStone(x,y) != reference->GetStone(x,y))
+                    return "stone differs at (" + std::to_string(x) + "," + std::to_string(y) + ")";
+
+                // The incrementally kept patterns against
+                // patterns read from the stones.
+                if(board->GetPattern({x,y}) != Pattern::Compute(*board, {x,y}))
+                    return "pattern differs at (" + std::to_string(x) + "," + std::to_string(y) + ")";
+            }
+        }
+
+        for(int side : {BLACK, WHITE})
+        {
+            if(board->GetCaptures(side) != reference->GetCaptures(side))
+                return "captures differ";
+
+            if(check_groups && GroupShapes(board->GetGroups(side)) != GroupShapes(reference->GetGroups(side)))
+                return "groups or liberties differ";
+
+            if(check_groups)
+            {
+                // The low liberty index against a scan.
+                std::vector<int> atari;
+                std::vector<int> two_liberties;
+                const std::vector<Group>& groups = board->GetGroups(side);
+                for(size_t i = 0; i < groups.size(); ++i)
+                {
+                    if(groups[i].liberties.size() == 1)
+                        atari.push_back(static_cast<int>(i));
+                    else if(groups[i].liberties.size() == 2)
+                        two_liberties.push_back(static_cast<int>(i));
+                }
+
+                if(atari != board->GetAtariGroups(side) || two_liberties != board->GetTwoLibertyGroups(side))
+                    return "low liberty index differs";
+
+                // The adjacent group index against the liberties.
+                std::vector<std::vector<int>> adjacent(kBoardSize*kBoardSize);
+                for(size_t i = 0; i < groups.size(); ++i)
+                {
+                    for(const Coordinate& liberty : groups[i].liberties)
+                        adjacent[liberty.As1D()].push_back(static_cast<int>(i));
+                }
+
+                for(int x = 0; x < kBoardSize; ++x)
+                {
+                    for(int y = 0; y < kBoardSize; ++y)
+                    {
+                        const AdjacentGroups& kept = board->GetAdjacentGroups({x,y}, side);
+                        std::vector<int> indexed(kept.groups.begin(), kept.groups.begin() + kept.count);
+                        if(indexed != adjacent[Coordinate{x,y}.As1D()])
+                            return "adjacent group index differs";
+                    }
+                }
+            }
+        }
+
+        // The cached safe areas have to match
+        // the ones found from scratch.
+        SafeAreas safe;
+        FindSafeAreas(*board, &safe);
+        if(safe != board->GetSafeAreas())
+            return "safe areas differ";
+
+        board->CalculateScore(JAPANESE_RULES);
+        reference->CalculateScore();
+
+        // The reference doesn't know about pass-alive areas,
+        // so its territory is corrected by the safe areas.
+        // The safe areas themselves are checked on their own,
+        // see CheckSafeStones and kKnownPositions.
+        std::array<int,NUM_COLORS> territory_count = {{0, reference->GetTerritoryCount(BLACK), reference->GetTerritoryCount(WHITE)}};
+
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            for(int y = 0; y < kBoardSize; ++y)
+            {
+                int expected = reference->GetTerritory(x,y);
+                int owner = safe[Coordinate{x,y}.As1D()];
+                int stone = reference->GetStone(x,y);
+
+                if(owner != EMPTY && stone != owner && expected != owner)
+                {
+                    if(expected == BLACK || expected == WHITE)
+                        --territory_count[expected];
+                    territory_count[owner] += (stone == EMPTY)?1:2;
+                    expected = owner;
+                }
+
+                if(board->GetTerritory(x,y) != expected)
+                    return "territory differs at (" + std::to_string(x) + "," + std::to_string(y) + ")";
+            }
+        }
+
+        for(int side : {BLACK, WHITE})
+        {
+            if(board->GetTerritoryCount(side) != territory_count[side])
+                return "territory count differs";
+        }
+
+        return "";
+    }
+
+    // Plays every opponent move sequence of up to plies moves
+    // on the reference board, with the owner passing in
+    // between, and checks that the stones stay on the board.
+    std::string CheckStonesSurvive(ReferenceBoard *reference, const std::vector<Coordinate>& stones, int owner, int plies)
+    {
+        for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+        {
+            Coordinate c = Coordinate::Get2dCoordinate(i);
+            if(reference->Occupied(c) || !reference->MakeMove(c))
+                continue;
+
+            std::string problem;
+            for(const Coordinate& stone : stones)
+            {
+                if(reference->GetStone(stone.x, stone.y) != owner)
+                {
+                    problem = "pass-alive stone at (" + std::to_string(stone.x) + "," + std::to_string(stone.y) + ") captured";
+                    break;
+                }
+            }
+
+            if(problem.empty() && plies > 1)
+            {
+                reference->Pass();
+                problem = CheckStonesSurvive(reference, stones, owner, plies - 1);
+                reference->UndoLastMove();
+            }
+
+            reference->UndoLastMove();
+
+            if(!problem.empty())
+                return problem;
+        }
+
+        return "";
+    }
+
+    // Checks Benson's algorithm without using it: the stones
+    // it calls pass-alive can't be captured by the opponent
+    // within plies moves, even if their owner only passes.
+    std::string CheckSafeStones(const ReferenceBoard& reference, const SafeAreas& safe, int plies)
+    {
+        for(int owner : {BLACK, WHITE})
+        {
+            std::vector<Coordinate> stones;
+            for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+            {
+                Coordinate c = Coordinate::Get2dCoordinate(i);
+                if(safe[i] == owner && reference.GetStone(c.x, c.y) == owner)
+                    stones.push_back(c);
+            }
+
+            if(stones.empty())
+                continue;
+
+            // The opponent moves first.
+            ReferenceBoard attacked = reference;
+            if(attacked.GetSideToMove() == owner)
+                attacked.Pass();
+
+            std::string problem = CheckStonesSurvive(&attacked, stones, owner, plies);
+            if(!problem.empty())
+                return problem;
+        }
+
+        return "";
+    }
+
+    // A position given as rows of X for black, O for
+    // white and . for empty points, and the color that
+    // should own each point of it by Benson's algorithm.
+    struct KnownPosition
+    {
+        const char *stones[kBoardSize];
+        const char *safe[kBoardSize];
+    };
+
+    const KnownPosition kKnownPositions[] =
+    {
+        // Two single point eyes.
+        {{".X.X.....", "XXXX.....", ".........", ".........", ".........", ".........", ".........", ".........", "........."},
+         {"XXXX.....", "XXXX.....", ".........", ".........", ".........", ".........", ".........", ".........", "........."}},
+
+        // A single eye isn't enough.
+        {{".XX......", "XXX......", ".........", ".........", ".........", ".........", ".........", ".........", "........."},
+         {".........", ".........", ".........", ".........", ".........", ".........", ".........", ".........", "........."}},
+
+        // A two point eye with a dead stone in it.
+        {{"O.X.X....", "XXXXX....", ".........", ".........", ".........", ".........", ".........", ".........", "........."},
+         {"XXXXX....", "XXXXX....", ".........", ".........", ".........", ".........", ".........", ".........", "........."}},
+
+        // The corner eye has a point no stone touches, so
+        // it isn't vital and one vital eye is left.
+        {{"..X.X....", "..XXX....", "XXX......", ".........", ".........", ".........", ".........", ".........", "........."},
+         {".........", ".........", ".........", ".........", ".........", ".........", ".........", ".........", "........."}},
+
+        // Three white blocks sharing four eyes.
+        {{".O.O.....", "O.O.O....", "OOOOO....", ".........", ".........", ".........", ".........", ".........", "........."},
+         {"OOOO.....", "OOOOO....", "OOOOO....", ".........", ".........", ".........", ".........", ".........", "........."}},
+    };
+
+    // Sets up the known positions, checks the safe areas
+    // found for them and that the safe stones survive.
+    std::string CheckKnownPositions(int plies)
+    {
+        for(size_t p = 0; p < sizeof(kKnownPositions)/sizeof(kKnownPositions[0]); ++p)
+        {
+            const KnownPosition& position = kKnownPositions[p];
+
+            Board board;
+            ReferenceBoard reference;
+            for(int y = 0; y < kBoardSize; ++y)
+            {
+                for(int x = 0; x < kBoardSize; ++x)
+                {
+                    char stone = position.stones[y][x];
+                    if(stone == '.')
+                        continue;
+
+                    int color = (stone == 'X')?BLACK:WHITE;
+                    if(board.GetSideToMove() != color)
+                    {
+                        board.Pass();
+                        reference.Pass();
+                    }
+
+                    board.MakeMove({x,y});
+                    reference.MakeMove({x,y});
+                }
+            }
+
+            std::string name = "known position " + std::to_string(p);
+
+            const SafeAreas& safe = board.GetSafeAreas();
+            for(int y = 0; y < kBoardSize; ++y)
+            {
+                for(int x = 0; x < kBoardSize; ++x)
+                {
+                    char owner = position.safe[y][x];
+                    int expected = (owner == 'X')?BLACK:((owner == 'O')?WHITE:EMPTY);
+                    if(safe[Coordinate{x,y}.As1D()] != expected)
+                        return name + ": safe area differs at (" + std::to_string(x) + "," + std::to_string(y) + ")";
+                }
+            }
+
+            std::string problem = CheckSafeStones(reference, safe, plies);
+            if(!problem.empty())
+                return name + ": " + problem;
+        }
+
+        return "";
+    }
+
+    std::string Describe(const std::vector<std::string>& actions, const std::string& problem)
+    {
+        std::ostringstream out;
+        out<<problem<<" after:";
+        for(const std::string& action : actions)
+            out<<" "<<action;
+
+        return out.str();
+    }
+
+    // Plays one random game and returns the number of
+    // actions, or stops at the first mismatch.
+    // The safe stones of the final position are checked
+    // against safe_area_plies opponent moves.
+    uint64_t PlayGame(std::mt19937 *rng, int moves, int safe_area_plies, std::string *mismatch)
+    {
+        Board board;
+        ReferenceBoard reference;
+
+        std::vector<std::string> actions;
+        Coordinate last = {kBoardSize/2, kBoardSize/2};
+
+        for(int i = 0; i < moves; ++i)
+        {
+            unsigned roll = (*rng)() % 100;
+            bool check_groups = false;
+
+            if(roll < 8)
+            {
+                board.Pass();
+                reference.Pass();
+                actions.push_back("pass");
+            }
+            else if(roll < 20)
+            {
+                board.UndoLastMove();
+                reference.UndoLastMove();
+                actions.push_back("undo");
+            }
+            else
+            {
+                // Mostly play next to the previous move.
+                Coordinate c;
+                if(roll < 60)
+                {
+                    c = {last.x + static_cast<int>((*rng)() % 5) - 2, last.y + static_cast<int>((*rng)() % 5) - 2};
+                    c.x = std::max(0, std::min(kBoardSize - 1, c.x));
+                    c.y = std::max(0, std::min(kBoardSize - 1, c.y));
+                }
+                else
+                    c = {static_cast<int>((*rng)() % kBoardSize), static_cast<int>((*rng)() % kBoardSize)};
+
+                if(board.Occupied(c))
+                    continue;
+
+                bool legal = board.MakeMove(c);
+                bool reference_legal = reference.MakeMove(c);
+
+                actions.push_back("(" + std::to_string(c.x) + "," + std::to_string(c.y) + ")" + (legal?"":"x"));
+
+                if(legal != reference_legal)
+                {
+                    *mismatch = Describe(actions, "legality differs");
+                    return actions.size();
+                }
+
+                check_groups = legal;
+                last = c;
+            }
+
+            std::string problem = Compare(&board, &reference, check_groups);
+            if(!problem.empty())
+            {
+                *mismatch = Describe(actions, problem);
+                return actions.size();
+            }
+        }
+
+        std::string problem = CheckSafeStones(reference, board.GetSafeAreas(), safe_area_plies);
+        if(!problem.empty())
+            *mismatch = Describe(actions, problem);
+
+        return actions.size();
+    }
+}
+
+DifferentialResult RunDifferentialValidation(const DifferentialOptions& options)
+{
+    DifferentialResult result;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<uint64_t> next_game{0};
+    std::atomic<uint64_t> actions{0};
+    std::atomic<uint64_t> mismatches{0};
+    std::mutex mismatch_mutex;
+
+    auto worker = [&]()
+    {
+        uint64_t game;
+        while((game = next_game++) < options.games)
+        {
+            // Seeded per game so that a failure can be
+            // replayed no matter which thread found it.
+            std::mt19937 rng(options.seed + game);
+
+            std::string mismatch;
+            actions += PlayGame(&rng, options.moves_per_game, options.safe_area_plies, &mismatch);
+
+            if(!mismatch.empty())
+            {
+                ++mismatches;
+
+                std::lock_guard<std::mutex> lock(mismatch_mutex);
+                if(result.first_mismatch.empty())
+                    result.first_mismatch = "game " + std::to_string(game) + ": " + mismatch;
+            }
+        }
+    };
+
+    std::string known = CheckKnownPositions(options.safe_area_plies);
+    if(!known.empty())
+    {
+        ++mismatches;
+        result.first_mismatch = known;
+    }
+
+    std::vector<std::thread> threads;
+    for(int i = 1; i < options.threads; ++i)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for(auto& thread : threads)
+        thread.join();
+
+    result.games = options.games;
+    result.actions = actions;
+    result.mismatches = mismatches;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+}
@@ -0,0 +1,45 @@
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include <cstdint>
+#include <string>
+
+// Plays random move sequences on Board and on the
+// ReferenceBoard side by side and checks that they agree
+// on everything the rules decide: legality of each move,
+// stones, captures, groups, liberties and territory.
+//
+// The sequences mix moves, passes and undos, and favor
+// points next to the previous move so that captures, ko
+// and suicide come up often.
+//
+// The pass-alive areas are checked on their own, since the
+// reference has no Benson's algorithm to compare with.
+
+struct DifferentialOptions
+{
+    uint64_t games = 10000;
+    int moves_per_game = 150;
+    int threads = 1;
+    uint32_t seed = 1;
+
+    // The pass-alive stones of the final positions and of a
+    // few known positions have to survive every opponent
+    // move sequence this long, with their owner passing.
+    int safe_area_plies = 2;
+};
+
+struct DifferentialResult
+{
+    uint64_t games = 0;
+    uint64_t actions = 0;
+    uint64_t mismatches = 0;
+    double seconds = 0;
+
+    // Description of the first mismatch found.
+    std::string first_mismatch;
+};
+
+DifferentialResult RunDifferentialValidation(const DifferentialOptions& options);
+
+#endif
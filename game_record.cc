@@ -0,0 +1,32 @@
+#include "game_record.h"
+
+bool ReplayGame(const GameRecord& record, Board *board, int nr_moves)
+{
+    int moves_to_play = record.moves.size();
+    if(nr_moves >= 0 && nr_moves < moves_to_play)
+        moves_to_play = nr_moves;
+
+    for(int i = 0; i < moves_to_play; ++i)
+    {
+        const Coordinate& move = record.moves[i];
+
+        if(move == kPassMove)
+        {
+            board->Pass();
+            continue;
+        }
+
+        if(move.x < 0 || move.x >= kBoardSize || move.y < 0 || move.y >= kBoardSize)
+            return false;
+
+        if(board->Occupied(move) || !board->MakeMove(move))
+            return false;
+    }
+
+    return true;
+}
+
+void RecordFromBoard(const Board& board, GameRecord *record)
+{
+    board.GetMoveHistory(&record->moves);
+}
@@ -0,0 +1,37 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include <vector>
+
+#include "board.h"
+
+// A finished or unfinished game independent
+// of the file format it was stored in.
+struct GameRecord
+{
+    int rules = JAPANESE_RULES;
+    float komi = kKomi;
+
+    // BLACK, WHITE or EMPTY if the result
+    // is unknown or the game was a draw.
+    int winner = EMPTY;
+
+    // Winning margin in points. Zero
+    // for resignations and unknown results.
+    float score = 0;
+    bool resigned = false;
+
+    // Moves in the order they were played,
+    // passes are given as kPassMove.
+    std::vector<Coordinate> moves;
+};
+
+// Plays the first nr_moves moves of the record on
+// the board, or all of them if nr_moves is negative.
+// Returns false if some move was illegal.
+bool ReplayGame(const GameRecord& record, Board *board, int nr_moves = -1);
+
+// Fills the record moves from the history of the board.
+void RecordFromBoard(const Board& board, GameRecord *record);
+
+#endif
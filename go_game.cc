@@ -1,4 +1,5 @@
 #include "go_game.h"
+#include "ownership.h"
 #include <SDL2/SDL.h>
 #include <iostream>
 
@@ -25,6 +26,52 @@ bool GoGame::Init(int window_width, int window_height)
     return true;
 }
 
+bool GoGame::LoadOpeningBook(const std::string& path)
+{
+    if(!opening_book.Open(path))
+        return false;
+
+    ai.SetOpeningBook(&opening_book);
+    return true;
+}
+
+bool GoGame::TraceSearches(const std::string& path)
+{
+    if(!search_trace.Open(path))
+        return false;
+
+    ai.SetSearchTrace(&search_trace);
+    return true;
+}
+
+bool GoGame::LoadParameters(const std::string& path)
+{
+    Parameters parameters = ai.GetParameters();
+    if(!::LoadParameters(path, &parameters))
+        return false;
+
+    ai.SetParameters(parameters);
+    return true;
+}
+
+bool GoGame::LoadNetwork(const std::string& path)
+{
+    if(!network.Load(path))
+        return false;
+
+    ai.SetNetwork(&network);
+    return true;
+}
+
+bool GoGame::LoadPolicy(const std::string& path)
+{
+    if(!policy.Load(path))
+        return false;
+
+    ai.SetPolicy(&policy);
+    return true;
+}
+
 void GoGame::DrawCircle(int radius, int x, int y, const SDL_Color& color)
 {
     SDL_SetRenderDrawColor(renderer,color.r,color.g,color.b,color.a);
@@ -203,6 +250,15 @@ void GoGame::Run(int play_mode, int side, int rules)
     {
         if(board.EndGame())
         {
+            OwnershipOptions options;
+            options.threads = 0;
+
+            std::vector<Coordinate> dead;
+            FindDeadStones(board, options, &dead);
+            board.RemoveDeadStones(dead);
+            board.CalculateScore(rules);
+            std::cout<<"Removed "<<dead.size()<<" dead stones.\n";
+
             board.PrintState();
             board.PrintEndScreen();
             break;
@@ -3,6 +3,9 @@
 
 #include "board.h"
 #include "ai.h"
+#include "opening_book.h"
+#include "search_trace.h"
+#include <string>
 #include <SDL2/SDL.h>
 
 enum Mode
@@ -22,6 +25,22 @@ public:
     bool Init(int window_width, int window_height);
     void Run(int play_mode, int side = BLACK, int rules = JAPANESE_RULES);
 
+    // Lets the ai play from an opening book file.
+    bool LoadOpeningBook(const std::string& path);
+
+    // Writes the search trees of the ai to a trace file.
+    bool TraceSearches(const std::string& path);
+
+    // Loads the evaluation and search parameters
+    // of the ai from a config file.
+    bool LoadParameters(const std::string& path);
+
+    // Lets the ai evaluate with a network file.
+    bool LoadNetwork(const std::string& path);
+
+    // Lets the ai order its moves with a policy file.
+    bool LoadPolicy(const std::string& path);
+
     void DrawCircle(int radius, int x, int y, const SDL_Color& color);
     void DrawStone(int x, int y, int color);
     void DrawTerritoryMarker(int x, int y, int color);
@@ -54,6 +73,10 @@ private:
 
     Board board;
     Ai ai;
+    OpeningBook opening_book;
+    NnueNetwork network;
+    MovePolicy policy;
+    SearchTraceWriter search_trace;
 
 };
 
@@ -0,0 +1,285 @@
+#include "ladder.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    const int kDirections[4] = {-1, 1, -kLadderWidth, kLadderWidth};
+
+    int Opponent(int color)
+    {
+        return (color == BLACK)?WHITE:BLACK;
+    }
+}
+
+uint64_t LadderReader::Key(const Board& board, const Coordinate& stone, int atari)
+{
+    uint64_t query = stone.As1D() + static_cast<uint64_t>(atari + 1)*kBoardSize*kBoardSize;
+    return board.GetHash() ^ ((query + 1)*0x9E3779B97F4A7C15ull);
+}
+
+void LadderReader::Load(const Board& board)
+{
+    points.fill(LADDER_BORDER);
+    for(int x = 0; x < kBoardSize; ++x)
+    {
+        for(int y = 0; y < kBoardSize; ++y)
+            points[Point({x,y})] = board.GetStone(x,y);
+    }
+
+    changes.clear();
+    nodes = 0;
+}
+
+void LadderReader::NextStamp()
+{
+    if(++stamp == 0)
+    {
+        marks.fill(0);
+        stamp = 1;
+    }
+}
+
+int LadderReader::Liberties(int point, int max_liberties, int *liberties)
+{
+    int color = points[point];
+    int count = 0;
+
+    NextStamp();
+    stack.clear();
+    stack.push_back(point);
+    marks[point] = stamp;
+
+    while(!stack.empty())
+    {
+        int p = stack.back();
+        stack.pop_back();
+
+        for(int direction : kDirections)
+        {
+            int n = p + direction;
+            if(marks[n] == stamp)
+                continue;
+
+            if(points[n] == EMPTY)
+            {
+                marks[n] = stamp;
+                liberties[count++] = n;
+                if(count == max_liberties)
+                    return count;
+            }
+            else if(points[n] == color)
+            {
+                marks[n] = stamp;
+                stack.push_back(n);
+            }
+        }
+    }
+
+    return count;
+}
+
+void LadderReader::Stones(int point, std::vector<int> *stones)
+{
+    int color = points[point];
+
+    NextStamp();
+    stones->clear();
+    stones->push_back(point);
+    marks[point] = stamp;
+
+    for(size_t i = 0; i < stones->size(); ++i)
+    {
+        int p = (*stones)[i];
+        for(int direction : kDirections)
+        {
+            int n = p + direction;
+            if(marks[n] != stamp && points[n] == color)
+            {
+                marks[n] = stamp;
+                stones->push_back(n);
+            }
+        }
+    }
+}
+
+bool LadderReader::Play(int point, int color)
+{
+    size_t mark = changes.size();
+    int opponent = Opponent(color);
+
+    points[point] = color;
+    changes.push_back({static_cast<int16_t>(point), EMPTY});
+
+    int liberty;
+    for(int direction : kDirections)
+    {
+        int n = point + direction;
+        if(points[n] != opponent || Liberties(n, 1, &liberty) > 0)
+            continue;
+
+        Stones(n, &group);
+        for(int stone : group)
+        {
+            points[stone] = EMPTY;
+            changes.push_back({static_cast<int16_t>(stone), static_cast<int8_t>(opponent)});
+        }
+    }
+
+    if(Liberties(point, 1, &liberty) == 0)
+    {
+        Undo(mark);
+        return false;
+    }
+
+    return true;
+}
+
+void LadderReader::Undo(size_t mark)
+{
+    while(changes.size() > mark)
+    {
+        points[changes.back().point] = changes.back().color;
+        changes.pop_back();
+    }
+}
+
+bool LadderReader::DefenderLoses(int point, int ply)
+{
+    ++nodes;
+    if(ply >= kMaxLadderPlies || nodes >= kMaxLadderNodes)
+        return false;
+
+    int color = points[point];
+    int attacker = Opponent(color);
+
+    // The escapes are extending on the last liberty
+    // and capturing a neighboring group in atari.
+    int escapes[kMaxLadderEscapes];
+    int nr_escapes = Liberties(point, 1, escapes);
+
+    Stones(point, &group);
+    for(size_t i = 0; i < group.size() && nr_escapes < kMaxLadderEscapes; ++i)
+    {
+        for(int direction : kDirections)
+        {
+            int n = group[i] + direction;
+            int captures[2];
+            if(points[n] == attacker && Liberties(n, 2, captures) == 1 &&
+               std::find(escapes, escapes + nr_escapes, captures[0]) == escapes + nr_escapes)
+            {
+                escapes[nr_escapes++] = captures[0];
+                if(nr_escapes == kMaxLadderEscapes)
+                    break;
+            }
+        }
+    }
+
+    for(int i = 0; i < nr_escapes; ++i)
+    {
+        int escape = escapes[i];
+        size_t mark = changes.size();
+        if(!Play(escape, color))
+            continue;
+
+        int liberties[3];
+        int count = Liberties(point, 3, liberties);
+
+        bool escaped = (count >= 3) || (count == 2 && !AttackerWins(point, ply + 1));
+        Undo(mark);
+
+        if(escaped)
+            return false;
+    }
+
+    return true;
+}
+
+bool LadderReader::AttackerWins(int point, int ply)
+{
+    ++nodes;
+    if(ply >= kMaxLadderPlies || nodes >= kMaxLadderNodes)
+        return false;
+
+    int attacker = Opponent(points[point]);
+
+    int liberties[2];
+    if(Liberties(point, 2, liberties) != 2)
+        return false;
+
+    int ataris[2] = {liberties[0], liberties[1]};
+    for(int atari : ataris)
+    {
+        size_t mark = changes.size();
+        if(!Play(atari, attacker))
+            continue;
+
+        bool captured = Liberties(point, 2, liberties) == 1 && DefenderLoses(point, ply + 1);
+        Undo(mark);
+
+        if(captured)
+            return true;
+    }
+
+    return false;
+}
+
+bool LadderReader::IsCaptured(const Board& board, const Coordinate& stone)
+{
+    PROFILE_ZONE("LadderReader::IsCaptured");
+
+    uint64_t key = Key(board, stone, -1);
+    auto found = cache.find(key);
+    if(found != cache.end())
+        return found->second;
+
+    Load(board);
+
+    int point = Point(stone);
+    int liberties[2];
+    bool captured = false;
+
+    if(points[point] != EMPTY && Liberties(point, 2, liberties) == 1)
+        captured = DefenderLoses(point, 0);
+
+    total_nodes += nodes;
+
+    if(cache.size() >= kMaxLadderCacheEntries)
+        cache.clear();
+    cache[key] = captured;
+
+    return captured;
+}
+
+bool LadderReader::AtariCaptures(const Board& board, const Coordinate& stone, const Coordinate& atari)
+{
+    PROFILE_ZONE("LadderReader::AtariCaptures");
+
+    uint64_t key = Key(board, stone, atari.As1D());
+    auto found = cache.find(key);
+    if(found != cache.end())
+        return found->second;
+
+    Load(board);
+
+    int point = Point(stone);
+    int liberties[2];
+    bool captured = false;
+
+    if(points[point] != EMPTY && Liberties(point, 2, liberties) == 2 &&
+       (liberties[0] == Point(atari) || liberties[1] == Point(atari)) &&
+       Play(Point(atari), Opponent(points[point])))
+    {
+        captured = Liberties(point, 2, liberties) == 1 && DefenderLoses(point, 1);
+        Undo(0);
+    }
+
+    total_nodes += nodes;
+
+    if(cache.size() >= kMaxLadderCacheEntries)
+        cache.clear();
+    cache[key] = captured;
+
+    return captured;
+}
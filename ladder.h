@@ -0,0 +1,110 @@
+#ifndef LADDER_H
+#define LADDER_H
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+
+// Reads ladders, the forced sequence where a group in
+// atari extends and the attacker keeps it in atari until
+// it either runs into a wall or gets out with three
+// liberties.
+//
+// The reader copies the stones of the board into its
+// own padded array and reads on that with a minimal make
+// and undo that only tracks the changed points. Results
+// are cached by the position hash and the group.
+
+const int kLadderWidth = kBoardSize + 2;
+const int kLadderPoints = kLadderWidth*kLadderWidth;
+
+// Reading gives up, and the group is taken to escape,
+// after this many plies or nodes.
+const int kMaxLadderPlies = 2*kBoardSize*kBoardSize;
+const int kMaxLadderNodes = 200;
+
+// The last liberty plus captures of neighbors in atari.
+const int kMaxLadderEscapes = 8;
+
+const size_t kMaxLadderCacheEntries = 1 << 16;
+
+class LadderReader
+{
+public:
+    // Whether the group with a stone at the point, which
+    // has to be in atari, is captured even if its side
+    // moves first. Extending such a group is a dead escape.
+    bool IsCaptured(const Board& board, const Coordinate& stone);
+
+    // Whether putting the group with a stone at the point,
+    // which has to have two liberties, in atari at the
+    // given liberty captures it in a ladder.
+    bool AtariCaptures(const Board& board, const Coordinate& stone, const Coordinate& atari);
+
+    // Nodes read since the reader was created.
+    uint64_t GetNodes() const { return total_nodes; }
+
+    void ClearCache() { cache.clear(); }
+
+private:
+    enum { LADDER_BORDER = 3 };
+
+    struct Change
+    {
+        int16_t point;
+        int8_t color;
+    };
+
+    void Load(const Board& board);
+
+    static int Point(const Coordinate& c) { return (c.y + 1)*kLadderWidth + c.x + 1; }
+
+    // Counts the liberties of the group at the point up
+    // to max_liberties and stores them in liberties.
+    int Liberties(int point, int max_liberties, int *liberties);
+
+    // The stones of the group at the point.
+    void Stones(int point, std::vector<int> *stones);
+
+    // Plays a stone, removing the neighboring groups
+    // without liberties. Returns false, with nothing
+    // changed, for suicides.
+    bool Play(int point, int color);
+    void Undo(size_t mark);
+
+    // The side of the group at the point is to move
+    // and the group is in atari.
+    bool DefenderLoses(int point, int ply);
+
+    // The attacker is to move and the group at
+    // the point has two liberties.
+    bool AttackerWins(int point, int ply);
+
+    // Cache keys are the position hash mixed with
+    // the stone and the atari point, -1 for none.
+    static uint64_t Key(const Board& board, const Coordinate& stone, int atari);
+
+    void NextStamp();
+
+    std::array<int8_t,kLadderPoints> points;
+    std::vector<Change> changes;
+
+    // Flood fill marks, a point is visited when
+    // its mark equals the current stamp.
+    std::array<uint32_t,kLadderPoints> marks = {{0}};
+    uint32_t stamp = 0;
+    std::vector<int> stack;
+
+    // Scratch space for the stones of a group.
+    std::vector<int> group;
+
+    int nodes = 0;
+    uint64_t total_nodes = 0;
+
+    std::unordered_map<uint64_t,bool> cache;
+};
+
+#endif
@@ -0,0 +1,347 @@
+#include "life_death.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    const uint32_t kProofInfinity = 1u << 30;
+
+    // Sums saturate at infinity. Both terms are at
+    // most infinity, so the sum can't overflow.
+    uint32_t AddProof(uint32_t a, uint32_t b)
+    {
+        return std::min(a + b, kProofInfinity);
+    }
+
+    int OppositeColor(int color)
+    {
+        return (color == BLACK)?WHITE:BLACK;
+    }
+
+    // The points next to the point that are on the board.
+    int Neighbors(const Coordinate& c, Coordinate *neighbors)
+    {
+        int count = 0;
+        if(c.x > 0)
+            neighbors[count++] = {c.x-1,c.y};
+        if(c.x < kBoardSize - 1)
+            neighbors[count++] = {c.x+1,c.y};
+        if(c.y > 0)
+            neighbors[count++] = {c.x,c.y-1};
+        if(c.y < kBoardSize - 1)
+            neighbors[count++] = {c.x,c.y+1};
+        return count;
+    }
+
+    // thresholds - total + child, clamped to infinity.
+    uint32_t ChildThreshold(uint32_t threshold, uint32_t total, uint32_t child)
+    {
+        uint64_t value = static_cast<uint64_t>(threshold) + child - total;
+        return static_cast<uint32_t>(std::min<uint64_t>(value, kProofInfinity));
+    }
+}
+
+uint64_t LifeSolver::Key(const Board& board)
+{
+    uint64_t key = board.GetHash();
+
+    Coordinate ko_point;
+    if(board.GetKoPoint(&ko_point))
+        key ^= (ko_point.As1D() + 1)*0x9E3779B97F4A7C15ull;
+
+    return key;
+}
+
+LifeSolver::ProofNumbers LifeSolver::Lookup(uint64_t key) const
+{
+    auto found = table.find(key);
+    if(found != table.end())
+        return found->second;
+
+    return {1, 1};
+}
+
+void LifeSolver::Store(uint64_t key, const ProofNumbers& numbers)
+{
+    if(table.size() >= kMaxLifeTableEntries && table.find(key) == table.end())
+        return;
+
+    table[key] = numbers;
+}
+
+bool LifeSolver::Terminal(ProofNumbers *numbers)
+{
+    if(board.GetStone(target.x, target.y) != defender)
+    {
+        *numbers = {0, kProofInfinity};
+        return true;
+    }
+
+    // Walk the group looking for a liberty
+    // outside the region.
+    Region visited;
+    std::vector<Coordinate> stack = {target};
+    visited.set(target.As1D());
+
+    while(!stack.empty())
+    {
+        Coordinate c = stack.back();
+        stack.pop_back();
+
+        Coordinate neighbors[4];
+        int nr_neighbors = Neighbors(c, neighbors);
+        for(int i = 0; i < nr_neighbors; ++i)
+        {
+            const Coordinate& n = neighbors[i];
+            if(visited.test(n.As1D()))
+                continue;
+
+            int stone = board.GetStone(n.x, n.y);
+            if(stone == EMPTY && !region.test(n.As1D()))
+            {
+                *numbers = {kProofInfinity, 0};
+                return true;
+            }
+
+            if(stone == defender)
+            {
+                visited.set(n.As1D());
+                stack.push_back(n);
+            }
+        }
+    }
+
+    return false;
+}
+
+void LifeSolver::GenerateChildren(std::vector<Child> *children)
+{
+    children->clear();
+
+    for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+    {
+        Coordinate c = Coordinate::Get2dCoordinate(i);
+        if(!region.test(i) || board.Occupied(c) || !board.MakeMove(c))
+            continue;
+
+        ++nodes;
+        children->push_back({c, Key(board)});
+
+        ProofNumbers numbers;
+        if(Terminal(&numbers))
+            Store(children->back().key, numbers);
+
+        board.UndoLastMove();
+    }
+
+    // The defender can always tenuki. The attacker only
+    // passes to wait out a ko ban, which Board also puts
+    // on recaptures that would take more than one stone.
+    Coordinate ko_point;
+    if(board.GetSideToMove() == defender || board.GetKoPoint(&ko_point))
+    {
+        board.Pass();
+        children->push_back({kPassMove, Key(board)});
+        board.UndoLastMove();
+    }
+}
+
+void LifeSolver::Search(int depth, uint32_t proof_threshold, uint32_t disproof_threshold)
+{
+    uint64_t key = Key(board);
+
+    if(depth >= options.max_depth)
+    {
+        Store(key, {kProofInfinity, 0});
+        return;
+    }
+
+    bool or_node = board.GetSideToMove() != defender;
+
+    std::vector<Child> children;
+    GenerateChildren(&children);
+
+    while(true)
+    {
+        // The attacker needs one child proved and the
+        // defender needs one child disproved.
+        uint32_t proof = or_node?kProofInfinity:0;
+        uint32_t disproof = or_node?0:kProofInfinity;
+
+        size_t best = 0;
+        uint32_t best_value = kProofInfinity;
+        uint32_t second_value = kProofInfinity;
+
+        for(size_t i = 0; i < children.size(); ++i)
+        {
+            ProofNumbers numbers = Lookup(children[i].key);
+            uint32_t value = or_node?numbers.proof:numbers.disproof;
+
+            if(or_node)
+            {
+                proof = std::min(proof, numbers.proof);
+                disproof = AddProof(disproof, numbers.disproof);
+            }
+            else
+            {
+                proof = AddProof(proof, numbers.proof);
+                disproof = std::min(disproof, numbers.disproof);
+            }
+
+            if(value < best_value)
+            {
+                second_value = best_value;
+                best_value = value;
+                best = i;
+            }
+            else if(value < second_value)
+                second_value = value;
+        }
+
+        Store(key, {proof, disproof});
+
+        if(proof >= proof_threshold || disproof >= disproof_threshold || nodes >= static_cast<uint64_t>(options.max_nodes))
+            return;
+
+        const Child& child = children[best];
+        ProofNumbers numbers = Lookup(child.key);
+
+        uint32_t child_proof_threshold;
+        uint32_t child_disproof_threshold;
+        if(or_node)
+        {
+            child_proof_threshold = std::min(proof_threshold, AddProof(second_value, 1));
+            child_disproof_threshold = ChildThreshold(disproof_threshold, disproof, numbers.disproof);
+        }
+        else
+        {
+            child_proof_threshold = ChildThreshold(proof_threshold, proof, numbers.proof);
+            child_disproof_threshold = std::min(disproof_threshold, AddProof(second_value, 1));
+        }
+
+        if(child.move == kPassMove)
+            board.Pass();
+        else
+            board.MakeMove(child.move);
+        ++nodes;
+
+        ProofNumbers terminal;
+        if(Terminal(&terminal))
+            Store(child.key, terminal);
+        else
+            Search(depth + 1, child_proof_threshold, child_disproof_threshold);
+
+        board.UndoLastMove();
+    }
+}
+
+LifeResult LifeSolver::Solve(const Board& position, const Coordinate& stone, const LifeOptions& solve_options)
+{
+    PROFILE_ZONE("LifeSolver::Solve");
+
+    LifeResult result;
+
+    int color = position.GetStone(stone.x, stone.y);
+    if(color == EMPTY)
+        return result;
+
+    uint64_t result_key = Key(position) ^ ((stone.As1D() + 1)*0xC2B2AE3D27D4EB4Full);
+    auto found = results.find(result_key);
+    if(found != results.end())
+        return found->second;
+
+    board = position;
+    board.SetNetwork(nullptr);
+    target = stone;
+    defender = color;
+    options = solve_options;
+    nodes = 0;
+
+    // The region grows from the group through empty points
+    // and the defender's stones, at most region_margin steps.
+    // The attacker's stones it runs into are included, so that
+    // points freed by captures can be played. An enclosed group
+    // gets just its eye space. The groups of the board may be
+    // stale, so the walk is done here.
+    region.reset();
+
+    std::vector<Coordinate> frontier = {stone};
+    region.set(stone.As1D());
+
+    for(size_t i = 0; i < frontier.size(); ++i)
+    {
+        Coordinate neighbors[4];
+        int nr_neighbors = Neighbors(frontier[i], neighbors);
+        for(int j = 0; j < nr_neighbors; ++j)
+        {
+            const Coordinate& n = neighbors[j];
+            if(!region.test(n.As1D()) && board.GetStone(n.x, n.y) == defender)
+            {
+                region.set(n.As1D());
+                frontier.push_back(n);
+            }
+        }
+    }
+
+    for(int step = 0; step < options.region_margin; ++step)
+    {
+        std::vector<Coordinate> next;
+        for(const Coordinate& c : frontier)
+        {
+            Coordinate neighbors[4];
+            int nr_neighbors = Neighbors(c, neighbors);
+            for(int j = 0; j < nr_neighbors; ++j)
+            {
+                const Coordinate& n = neighbors[j];
+                if(region.test(n.As1D()))
+                    continue;
+
+                region.set(n.As1D());
+                if(board.GetStone(n.x, n.y) != OppositeColor(defender))
+                    next.push_back(n);
+            }
+        }
+        frontier.swap(next);
+    }
+
+    table.clear();
+
+    ProofNumbers root;
+    if(region.none() || Terminal(&root))
+        return result;
+
+    Search(0, kProofInfinity, kProofInfinity);
+
+    root = Lookup(Key(board));
+    result.nodes = nodes;
+
+    if(root.proof == 0)
+        result.status = LIFE_DEAD;
+    else if(root.disproof == 0)
+        result.status = LIFE_ALIVE;
+
+    // The child that decides the result for the side to move.
+    bool attacker_to_move = board.GetSideToMove() != defender;
+    if((result.status == LIFE_DEAD && attacker_to_move) || (result.status == LIFE_ALIVE && !attacker_to_move))
+    {
+        std::vector<Child> children;
+        GenerateChildren(&children);
+
+        for(const Child& child : children)
+        {
+            ProofNumbers numbers = Lookup(child.key);
+            if((attacker_to_move && numbers.proof == 0) || (!attacker_to_move && numbers.disproof == 0))
+            {
+                result.key_move = child.move;
+                break;
+            }
+        }
+    }
+
+    if(results.size() >= kMaxLifeResults)
+        results.clear();
+    results[result_key] = result;
+
+    return result;
+}
@@ -0,0 +1,119 @@
+#ifndef LIFE_DEATH_H
+#define LIFE_DEATH_H
+
+#include <bitset>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+
+// A local life and death solver.
+//
+// Reads whether the opponent of a target group can
+// capture it with df-pn, depth first proof number search,
+// on a copy of the board. Both sides only play on the
+// empty points of a region around the group. The
+// defender may also pass, the attacker only under a
+// ko ban. The region spreads from the
+// group over empty points and the defender's stones for
+// region_margin steps, so an enclosed group only gets
+// its eye space. The attacker wins when the
+// target stone is captured. The defender wins when the
+// group gets a liberty outside the region, when the
+// attacker runs out of moves, e.g. in seki, or when the
+// reading gets deeper than max_depth. So a group is only
+// called dead if it dies within the horizon.
+//
+// Positions are stored in a transposition table keyed
+// by the hash and the ko point. Paths into the same
+// position are not told apart, which is the usual
+// df-pn approximation. The table is cleared for every
+// solve, the results are cached by position and target.
+
+enum LifeStatus
+{
+    LIFE_ALIVE,
+    LIFE_DEAD,
+    LIFE_UNKNOWN
+};
+
+struct LifeOptions
+{
+    // Reading stops with LIFE_UNKNOWN after this
+    // many moves have been made.
+    int max_nodes = 20000;
+
+    // Steps the region spreads from the group.
+    int region_margin = 2;
+
+    int max_depth = 30;
+};
+
+struct LifeResult
+{
+    // For the side to move of the board.
+    LifeStatus status = LIFE_UNKNOWN;
+
+    // The move that kills, if the attacker is to move
+    // and the group is dead, or the move that lives, if
+    // the defender is to move and the group is alive.
+    // kPassMove if there is none or it is a pass.
+    Coordinate key_move = kPassMove;
+
+    uint64_t nodes = 0;
+};
+
+const size_t kMaxLifeTableEntries = 1 << 18;
+const size_t kMaxLifeResults = 1 << 12;
+
+class LifeSolver
+{
+public:
+    LifeResult Solve(const Board& board, const Coordinate& stone, const LifeOptions& options = LifeOptions());
+
+    void ClearCache() { results.clear(); }
+
+private:
+    typedef std::bitset<kBoardSize*kBoardSize> Region;
+
+    struct ProofNumbers
+    {
+        uint32_t proof;
+        uint32_t disproof;
+    };
+
+    struct Child
+    {
+        Coordinate move;
+        uint64_t key;
+    };
+
+    // The attacker is to move at OR nodes.
+    void Search(int depth, uint32_t proof_threshold, uint32_t disproof_threshold);
+
+    // Proof numbers of a position that is
+    // decided on the spot, otherwise false.
+    bool Terminal(ProofNumbers *numbers);
+
+    void GenerateChildren(std::vector<Child> *children);
+
+    ProofNumbers Lookup(uint64_t key) const;
+    void Store(uint64_t key, const ProofNumbers& numbers);
+
+    // The position hash with the ko point mixed in.
+    static uint64_t Key(const Board& board);
+
+    Board board;
+    Coordinate target;
+    int defender = EMPTY;
+    Region region;
+
+    LifeOptions options;
+    uint64_t nodes = 0;
+
+    std::unordered_map<uint64_t,ProofNumbers> table;
+    std::unordered_map<uint64_t,LifeResult> results;
+};
+
+#endif
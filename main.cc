@@ -1,12 +1,353 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <thread>
 #include "go_game.h"
+#include "server.h"
+#include "sgf.h"
+#include "record_file.h"
+#include "opening_book.h"
+#include "benchmark.h"
+#include "perft.h"
+#include "search_trace.h"
+#include "differential.h"
+#include "concurrency.h"
+#include "parameters.h"
+#include "spsa.h"
+#include "self_play.h"
+#include "texel.h"
+#include "policy.h"
 
-int main()
+// Replays every game of an SGF collection and
+// reports how many of them could be played.
+static int ReplaySgf(const std::string& path)
 {
+    SgfReader reader;
+    if(!reader.Open(path))
+    {
+        std::cout<<"Couldn't open "<<path<<".\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    int games = 0;
+    int replayed = 0;
+    SgfGame game;
+    GameRecord record;
+    while(reader.NextGame(&game))
+    {
+        ++games;
+
+        Board board;
+        if(SgfToRecord(game, &record) && ReplayGame(record, &board))
+            ++replayed;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout<<"Replayed "<<replayed<<" of "<<games<<" games in "<<seconds<<" s.\n";
+    if(reader.Failed())
+        std::cout<<"Syntax error near byte "<<reader.Position()<<".\n";
+
+    return reader.Failed()?1:0;
+}
+
+// Runs perft on the empty board or on the final
+// position of the first game of an SGF file.
+static int RunPerftTool(int argc, char *argv[])
+{
+    PerftOptions options;
+    options.depth = std::stoi(argv[2]);
+    options.threads = (argc > 3)?std::stoi(argv[3]):std::thread::hardware_concurrency();
+
+    Board board;
+    if(argc > 4)
+    {
+        SgfReader reader;
+        SgfGame game;
+        GameRecord record;
+
+        if(!reader.Open(argv[4]) || !reader.NextGame(&game) || !SgfToRecord(game, &record) || !ReplayGame(record, &board))
+        {
+            std::cout<<"Couldn't read a position from "<<argv[4]<<".\n";
+            return 1;
+        }
+    }
+
+    PerftResult result = RunPerft(board, options);
+
+    for(const auto& entry : result.divide)
+    {
+        if(entry.first == kPassMove)
+            std::cout<<"pass: "<<entry.second<<"\n";
+        else
+            std::cout<<"("<<entry.first.x<<","<<entry.first.y<<"): "<<entry.second<<"\n";
+    }
+
+    std::cout<<"Depth "<<options.depth<<": "<<result.nodes<<" nodes in "<<result.seconds<<" s, ";
+    std::cout<<((result.seconds > 0)?result.nodes/result.seconds:0)<<" nodes/s with "<<options.threads<<" threads.\n";
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mode = (argc > 1)?argv[1]:"";
+
+    // go-ai --server [port] [search threads] [config file]
+    if(mode == "--server")
+    {
+        int port = (argc > 2)?std::stoi(argv[2]):kDefaultServerPort;
+        int threads = (argc > 3)?std::stoi(argv[3]):std::thread::hardware_concurrency();
+
+        GameServer server(threads, threads*4);
+
+        Parameters parameters;
+        if(argc > 4 && !LoadParameters(argv[4], &parameters))
+        {
+            std::cout<<"Couldn't load the parameters "<<argv[4]<<".\n";
+            return 1;
+        }
+        server.SetParameters(parameters);
+
+        if(!server.Run(port))
+        {
+            std::cout<<"Couldn't listen on port "<<port<<".\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // go-ai --replay-sgf <file>
+    if(mode == "--replay-sgf" && argc > 2)
+        return ReplaySgf(argv[2]);
+
+    // go-ai --sgf-to-records <sgf file> <record file>
+    // go-ai --records-to-sgf <record file> <sgf file>
+    if((mode == "--sgf-to-records" || mode == "--records-to-sgf") && argc > 3)
+    {
+        int64_t converted = (mode == "--sgf-to-records")?
+            ConvertSgfToRecords(argv[2], argv[3]):
+            ConvertRecordsToSgf(argv[2], argv[3]);
+
+        if(converted < 0)
+        {
+            std::cout<<"Conversion failed.\n";
+            return 1;
+        }
+
+        std::cout<<"Converted "<<converted<<" games.\n";
+        return 0;
+    }
+
+    // go-ai --build-book <record file> <book file> [plies]
+    if(mode == "--build-book" && argc > 3)
+    {
+        int plies = (argc > 4)?std::stoi(argv[4]):kDefaultBookPlies;
+
+        int64_t entries = BuildOpeningBook(argv[2], argv[3], plies);
+        if(entries < 0)
+        {
+            std::cout<<"Couldn't build the opening book.\n";
+            return 1;
+        }
+
+        std::cout<<"Wrote "<<entries<<" book entries.\n";
+        return 0;
+    }
+
+    // go-ai --bench [output file] [search depth]
+    if(mode == "--bench")
+    {
+        std::string output = (argc > 2)?argv[2]:"";
+        int depth = (argc > 3)?std::stoi(argv[3]):2;
+
+        return RunBenchmarks(output, depth)?0:1;
+    }
+
+    // go-ai --perft <depth> [threads] [sgf file]
+    if(mode == "--perft" && argc > 2)
+        return RunPerftTool(argc, argv);
+
+    // go-ai --trace-to-dot <trace file> <dot file> [max nodes]
+    // go-ai --trace-to-json <trace file> <json file> [max nodes]
+    if((mode == "--trace-to-dot" || mode == "--trace-to-json") && argc > 3)
+    {
+        size_t max_nodes = (argc > 4)?std::stoul(argv[4]):10000;
+
+        bool converted = (mode == "--trace-to-dot")?
+            TraceToDot(argv[2], argv[3], max_nodes):
+            TraceToJson(argv[2], argv[3], max_nodes);
+
+        if(!converted)
+        {
+            std::cout<<"Couldn't convert "<<argv[2]<<".\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // go-ai --validate [games] [threads]
+    if(mode == "--validate")
+    {
+        DifferentialOptions options;
+        if(argc > 2)
+            options.games = std::stoull(argv[2]);
+        options.threads = (argc > 3)?std::stoi(argv[3]):std::thread::hardware_concurrency();
+
+        DifferentialResult result = RunDifferentialValidation(options);
+
+        std::cout<<"Played "<<result.games<<" games, "<<result.actions<<" actions in "<<result.seconds<<" s, ";
+        std::cout<<result.mismatches<<" mismatches.\n";
+        if(result.mismatches > 0)
+            std::cout<<"First mismatch: "<<result.first_mismatch<<"\n";
+
+        return (result.mismatches == 0)?0:1;
+    }
+
+    // go-ai --concurrency [games]
+    // Plays the games at the same time, see concurrency.h.
+    if(mode == "--concurrency")
+    {
+        ConcurrencyOptions options;
+        if(argc > 2)
+            options.games = std::stoi(argv[2]);
+
+        ConcurrencyResult result = RunConcurrencyTest(options);
+
+        std::cout<<"Played "<<result.games<<" games at once in "<<result.seconds<<" s, ";
+        std::cout<<result.mismatches<<" mismatches.\n";
+        if(result.mismatches > 0)
+            std::cout<<"First mismatch: "<<result.first_mismatch<<"\n";
+
+        return (result.mismatches == 0)?0:1;
+    }
+
+    // go-ai --tune <config file> [iterations] [threads]
+    // Starts from the config file if it exists and
+    // writes the tuned parameters back to it.
+    if(mode == "--tune" && argc > 2)
+    {
+        SpsaOptions options;
+        options.output_path = argv[2];
+        options.iterations = (argc > 3)?std::stoi(argv[3]):0;
+        options.threads = (argc > 4)?std::stoi(argv[4]):std::thread::hardware_concurrency();
+        options.games_per_iteration = 2*options.threads;
+
+        Parameters parameters;
+        if(std::ifstream(argv[2]) && !LoadParameters(argv[2], &parameters))
+        {
+            std::cout<<"Couldn't load the parameters "<<argv[2]<<".\n";
+            return 1;
+        }
+
+        RunSpsa(parameters, options);
+        return 0;
+    }
+
+    // go-ai --match <config file> <config file> [games] [threads]
+    // Plays the two sets of parameters against each other.
+    if(mode == "--match" && argc > 3)
+    {
+        int games = (argc > 4)?std::stoi(argv[4]):20;
+        int threads = (argc > 5)?std::stoi(argv[5]):std::max(1u, std::thread::hardware_concurrency());
+
+        if(games < 1 || threads < 1)
+        {
+            std::cout<<"The number of games and threads has to be at least 1.\n";
+            return 1;
+        }
+
+        Parameters first;
+        Parameters second;
+        if(!LoadParameters(argv[2], &first) || !LoadParameters(argv[3], &second))
+        {
+            std::cout<<"Couldn't load the parameters.\n";
+            return 1;
+        }
+
+        MatchResult result = PlayMatch(first, second, (games + 1)/2, threads, 1, SelfPlayOptions());
+
+        std::cout<<argv[2]<<" won "<<result.wins<<" of "<<result.games<<" games in "<<result.seconds<<" s.\n";
+        std::cout<<"Nodes per game: "<<result.nodes/result.games<<" against "<<result.opponent_nodes/result.games<<".\n";
+        return 0;
+    }
+
+    // go-ai --texel <record file> <config file> [epochs] [threads]
+    // Starts from the config file if it exists and
+    // writes the fitted parameters back to it.
+    if(mode == "--texel" && argc > 3)
+    {
+        TexelOptions options;
+        options.output_path = argv[3];
+        if(argc > 4)
+            options.epochs = std::stoi(argv[4]);
+        options.threads = (argc > 5)?std::stoi(argv[5]):std::thread::hardware_concurrency();
+
+        Parameters parameters;
+        if(std::ifstream(argv[3]) && !LoadParameters(argv[3], &parameters))
+        {
+            std::cout<<"Couldn't load the parameters "<<argv[3]<<".\n";
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        FeatureMatrix matrix;
+        if(!ExtractFeatures(argv[2], parameters, options, &matrix))
+        {
+            std::cout<<"Couldn't read "<<argv[2]<<".\n";
+            return 1;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout<<"Extracted "<<matrix.Size()<<" positions in "<<seconds<<" s.\n";
+
+        RunTexelTuning(matrix, parameters, options);
+        return 0;
+    }
+
+    // go-ai --train-policy <record file> <policy file> [epochs] [threads]
+    if(mode == "--train-policy" && argc > 3)
+    {
+        PolicyTrainingOptions options;
+        if(argc > 4)
+            options.epochs = std::stoi(argv[4]);
+        options.threads = (argc > 5)?std::stoi(argv[5]):std::thread::hardware_concurrency();
+
+        if(!TrainPolicy(argv[2], argv[3], options))
+        {
+            std::cout<<"Couldn't train the policy.\n";
+            return 1;
+        }
+        return 0;
+    }
+
     GoGame go;
     if(!go.Init(500,500))
         return 1;
 
+    // go-ai [--book <book file>] [--trace <trace file>] [--config <config file>]
+    //       [--nnue <network file>] [--policy <policy file>]
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+
+        if(option == "--book" && !go.LoadOpeningBook(argv[i+1]))
+            std::cout<<"Couldn't load the opening book "<<argv[i+1]<<".\n";
+        else if(option == "--trace" && !go.TraceSearches(argv[i+1]))
+            std::cout<<"Couldn't open the trace file "<<argv[i+1]<<".\n";
+        else if(option == "--config" && !go.LoadParameters(argv[i+1]))
+            std::cout<<"Couldn't load the parameters "<<argv[i+1]<<".\n";
+        else if(option == "--nnue" && !go.LoadNetwork(argv[i+1]))
+            std::cout<<"Couldn't load the network "<<argv[i+1]<<".\n";
+        else if(option == "--policy" && !go.LoadPolicy(argv[i+1]))
+            std::cout<<"Couldn't load the policy "<<argv[i+1]<<".\n";
+    }
+
     go.Run(AI_MODE);
 
     /*
@@ -0,0 +1,57 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path, bool sequential)
+{
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat info;
+    if(fstat(fd, &info) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // An empty file can't be mapped,
+    // but it is still a valid file.
+    if(info.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapping == MAP_FAILED)
+        return false;
+
+    madvise(mapping, info.st_size, sequential?MADV_SEQUENTIAL:MADV_RANDOM);
+
+    data = static_cast<const char*>(mapping);
+    size = info.st_size;
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if(data != nullptr)
+        munmap(const_cast<char*>(data), size);
+
+    data = nullptr;
+    size = 0;
+}
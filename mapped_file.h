@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A read-only memory mapping of a whole file.
+// The mapping is released when the object is
+// destroyed.
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the file at the given path. Set sequential
+    // if the file is mostly read from start to end.
+    // Returns false if the file couldn't be mapped.
+    bool Open(const std::string& path, bool sequential = true);
+    void Close();
+
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+    std::string_view View() const { return std::string_view(data, size); }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+#endif
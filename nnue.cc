@@ -0,0 +1,162 @@
+#include "nnue.h"
+#include "board.h"
+#include "mapped_file.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static_assert(kNnuePoints == kBoardSize*kBoardSize, "The network inputs don't match the board.");
+
+namespace
+{
+    int FeatureIndex(int color, int point)
+    {
+        return (color == WHITE)*kNnuePoints + point;
+    }
+
+    template<typename T>
+    bool ReadArray(const char **data, const char *end, std::vector<T> *values)
+    {
+        size_t bytes = values->size()*sizeof(T);
+        if(static_cast<size_t>(end - *data) < bytes)
+            return false;
+
+        std::memcpy(values->data(), *data, bytes);
+        *data += bytes;
+        return true;
+    }
+
+    template<typename T>
+    void WriteArray(std::ofstream& out, const std::vector<T>& values)
+    {
+        out.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(T));
+    }
+}
+
+bool NnueNetwork::Load(const std::string& path)
+{
+    MappedFile file;
+    if(!file.Open(path))
+        return false;
+
+    const char *data = file.Data();
+    const char *end = data + file.Size();
+
+    NnueFileHeader header;
+    if(file.Size() < sizeof(header))
+        return false;
+
+    std::memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+
+    if(std::memcmp(header.magic, kNnueMagic, 4) != 0 || header.version != kNnueVersion)
+        return false;
+
+    if(header.inputs != kNnueInputs || header.hidden1 != kNnueHidden1 || header.hidden2 != kNnueHidden2)
+        return false;
+
+    NnueNetwork loaded;
+    loaded.output_scale = header.output_scale;
+
+    std::vector<int32_t> output_bias_value(1);
+    if(!ReadArray(&data, end, &loaded.feature_weights) ||
+        !ReadArray(&data, end, &loaded.feature_bias) ||
+        !ReadArray(&data, end, &loaded.hidden_weights) ||
+        !ReadArray(&data, end, &loaded.hidden_bias) ||
+        !ReadArray(&data, end, &loaded.output_weights) ||
+        !ReadArray(&data, end, &output_bias_value))
+        return false;
+
+    if(data != end || loaded.output_scale == 0)
+        return false;
+
+    loaded.output_bias = output_bias_value[0];
+    loaded.Prepare();
+    *this = loaded;
+    return true;
+}
+
+bool NnueNetwork::Save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if(!out)
+        return false;
+
+    NnueFileHeader header;
+    std::memcpy(header.magic, kNnueMagic, 4);
+    header.version = kNnueVersion;
+    header.inputs = kNnueInputs;
+    header.hidden1 = kNnueHidden1;
+    header.hidden2 = kNnueHidden2;
+    header.output_scale = output_scale;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    WriteArray(out, feature_weights);
+    WriteArray(out, feature_bias);
+    WriteArray(out, hidden_weights);
+    WriteArray(out, hidden_bias);
+    WriteArray(out, output_weights);
+    out.write(reinterpret_cast<const char*>(&output_bias), sizeof(output_bias));
+
+    return static_cast<bool>(out.flush());
+}
+
+void NnueNetwork::Prepare()
+{
+    wide_hidden_weights.assign(hidden_weights.begin(), hidden_weights.end());
+}
+
+void NnueNetwork::ResetAccumulator(NnueAccumulator *accumulator) const
+{
+    std::copy(feature_bias.begin(), feature_bias.end(), accumulator->values);
+}
+
+void NnueNetwork::AddStone(NnueAccumulator *accumulator, int color, int point) const
+{
+    const int16_t *weights = &feature_weights[FeatureIndex(color, point)*kNnueHidden1];
+    for(int i = 0; i < kNnueHidden1; ++i)
+        accumulator->values[i] += weights[i];
+}
+
+void NnueNetwork::RemoveStone(NnueAccumulator *accumulator, int color, int point) const
+{
+    const int16_t *weights = &feature_weights[FeatureIndex(color, point)*kNnueHidden1];
+    for(int i = 0; i < kNnueHidden1; ++i)
+        accumulator->values[i] -= weights[i];
+}
+
+float NnueNetwork::Evaluate(const NnueAccumulator& accumulator) const
+{
+    PROFILE_ZONE("NnueNetwork::Evaluate");
+
+    // The loops have fixed lengths and multiply 16 bit
+    // values into 32 bit sums, which compiles to packed
+    // multiply-adds even without SSSE3 or AVX2.
+    alignas(32) int16_t input[kNnueHidden1];
+    for(int i = 0; i < kNnueHidden1; ++i)
+    {
+        int16_t value = accumulator.values[i];
+        input[i] = (value < 0)?0:((value > 127)?127:value);
+    }
+
+    alignas(32) int16_t hidden[kNnueHidden2];
+    for(int j = 0; j < kNnueHidden2; ++j)
+    {
+        const int16_t *weights = &wide_hidden_weights[j*kNnueHidden1];
+
+        int32_t sum = 0;
+        for(int i = 0; i < kNnueHidden1; ++i)
+            sum += static_cast<int32_t>(input[i])*weights[i];
+
+        sum = (sum + hidden_bias[j]) >> kNnueHiddenShift;
+        hidden[j] = static_cast<int16_t>(std::min(127, std::max(0, sum)));
+    }
+
+    int32_t output = output_bias;
+    for(int j = 0; j < kNnueHidden2; ++j)
+        output += static_cast<int32_t>(hidden[j])*output_weights[j];
+
+    return output/output_scale;
+}
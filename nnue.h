@@ -0,0 +1,105 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A small quantized value network in the style of
+// NNUE, evaluated on the cpu.
+//
+// The input is one feature per stone: color times
+// point. The first layer is a sum of the weight rows
+// of the stones on the board, the accumulator, which
+// boards keep up to date as stones are placed and
+// removed. The rest of the network is two small
+// layers over the clipped accumulator:
+//
+//   accumulator   int16[kNnueHidden1], clipped to 0..127
+//   hidden layer  int8 weights, int32 sums >> kNnueHiddenShift, clipped to 0..127
+//   output        int8 weights, int32 sum / output_scale
+//
+// The output is in the units of Board::Evaluate,
+// positive for black.
+//
+// The weights file is a NnueFileHeader followed by,
+// in native byte order (little endian on the supported
+// hosts) and without padding:
+//
+//   int16 feature_weights[kNnueInputs][kNnueHidden1]
+//   int16 feature_bias[kNnueHidden1]
+//   int8  hidden_weights[kNnueHidden2][kNnueHidden1]
+//   int32 hidden_bias[kNnueHidden2]
+//   int8  output_weights[kNnueHidden2]
+//   int32 output_bias
+//
+// Feature (color, point) has the index
+// (color == WHITE)*kNnuePoints + y*kBoardSize + x.
+
+const char kNnueMagic[4] = {'G','O','N','N'};
+const uint32_t kNnueVersion = 1;
+
+const int kNnuePoints = 81;
+const int kNnueInputs = 2*kNnuePoints;
+const int kNnueHidden1 = 128;
+const int kNnueHidden2 = 32;
+const int kNnueHiddenShift = 6;
+
+#pragma pack(push, 1)
+struct NnueFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t inputs;
+    uint32_t hidden1;
+    uint32_t hidden2;
+    float output_scale;
+};
+#pragma pack(pop)
+
+struct NnueAccumulator
+{
+    alignas(32) int16_t values[kNnueHidden1];
+};
+
+class NnueNetwork
+{
+public:
+    // Returns false if the file couldn't be read
+    // or was made for a different network shape.
+    bool Load(const std::string& path);
+
+    // Writes the weights in the format read by Load.
+    bool Save(const std::string& path) const;
+
+    // Has to be called after changing the weights
+    // directly. Load calls it.
+    void Prepare();
+
+    // Sets the accumulator for a board without stones.
+    void ResetAccumulator(NnueAccumulator *accumulator) const;
+
+    // Adds or removes one stone, color being
+    // BLACK or WHITE and point y*kBoardSize + x.
+    void AddStone(NnueAccumulator *accumulator, int color, int point) const;
+    void RemoveStone(NnueAccumulator *accumulator, int color, int point) const;
+
+    // Runs the layers after the accumulator.
+    float Evaluate(const NnueAccumulator& accumulator) const;
+
+    // The raw weights, for tools that make networks.
+    std::vector<int16_t> feature_weights = std::vector<int16_t>(kNnueInputs*kNnueHidden1);
+    std::vector<int16_t> feature_bias = std::vector<int16_t>(kNnueHidden1);
+    std::vector<int8_t> hidden_weights = std::vector<int8_t>(kNnueHidden2*kNnueHidden1);
+    std::vector<int32_t> hidden_bias = std::vector<int32_t>(kNnueHidden2);
+    std::vector<int8_t> output_weights = std::vector<int8_t>(kNnueHidden2);
+    int32_t output_bias = 0;
+    float output_scale = 1;
+
+private:
+    // The hidden weights widened to 16 bits, which
+    // is what the dot products multiply with.
+    std::vector<int16_t> wide_hidden_weights = std::vector<int16_t>(kNnueHidden2*kNnueHidden1);
+};
+
+#endif
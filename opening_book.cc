@@ -0,0 +1,182 @@
+#include "opening_book.h"
+#include "record_file.h"
+#include "symmetry.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Maps a move to the canonical orientation of the position.
+//
+// A position can be symmetric in itself, e.g. the empty
+// board. Then several symmetries produce the canonical hash
+// and a move has several images. The smallest one is used
+// so that equivalent moves end up in the same entry.
+static int CanonicalPoint(const Board& board, uint64_t canonical_hash, const Coordinate& move)
+{
+    int best = kBoardSize*kBoardSize;
+    for(int s = 0; s < kNumSymmetries; ++s)
+    {
+        if(board.GetHash(s) == canonical_hash)
+            best = std::min(best, TransformPoint(move, s).As1D());
+    }
+
+    return best;
+}
+
+bool OpeningBook::Open(const std::string& path)
+{
+    entries = nullptr;
+    nr_entries = 0;
+
+    if(!file.Open(path, false))
+        return false;
+
+    BookFileHeader header;
+    if(file.Size() < sizeof(header))
+        return false;
+
+    memcpy(&header, file.Data(), sizeof(header));
+    if(memcmp(header.magic, kBookMagic, 4) != 0 || header.version != kBookVersion)
+        return false;
+
+    if(sizeof(header) + header.nr_entries*sizeof(BookEntry) != file.Size())
+        return false;
+
+    // The header is 16 bytes and the mapping is page
+    // aligned, so the entries are properly aligned.
+    entries = reinterpret_cast<const BookEntry*>(file.Data() + sizeof(header));
+    nr_entries = header.nr_entries;
+
+    return true;
+}
+
+void OpeningBook::GetMoves(const Board& board, std::vector<BookMove> *moves) const
+{
+    moves->clear();
+
+    if(!Loaded())
+        return;
+
+    int symmetry;
+    uint64_t key = board.GetCanonicalHash(&symmetry);
+
+    const BookEntry *end = entries + nr_entries;
+    const BookEntry *found = std::lower_bound(entries, end, key,
+        [](const BookEntry& entry, uint64_t key)
+        {
+            return entry.key < key;
+        });
+
+    for(; found != end && found->key == key; ++found)
+    {
+        Coordinate canonical = Coordinate::Get2dCoordinate(found->point);
+        moves->push_back({InverseTransformPoint(canonical, symmetry), found->weight});
+    }
+
+    std::sort(moves->begin(), moves->end(),
+        [](const BookMove& m1, const BookMove& m2)
+        {
+            return m1.weight > m2.weight;
+        });
+}
+
+bool OpeningBook::Probe(const Board& board, Coordinate *move) const
+{
+    std::vector<BookMove> moves;
+    GetMoves(board, &moves);
+
+    if(moves.empty())
+        return false;
+
+    *move = moves[0].point;
+    return true;
+}
+
+void OpeningBookBuilder::AddGame(const GameRecord& record, int max_plies)
+{
+    Board board;
+
+    int plies = std::min<int>(max_plies, record.moves.size());
+    for(int i = 0; i < plies; ++i)
+    {
+        const Coordinate& move = record.moves[i];
+        if(move == kPassMove)
+            break;
+
+        int symmetry;
+        uint64_t key = board.GetCanonicalHash(&symmetry);
+
+        uint32_t weight = (board.GetSideToMove() == record.winner)?2:1;
+        positions[key][CanonicalPoint(board, key, move)] += weight;
+
+        if(board.Occupied(move) || !board.MakeMove(move))
+            break;
+    }
+}
+
+bool OpeningBookBuilder::Write(const std::string& path, uint32_t min_weight)
+{
+    std::vector<BookEntry> book;
+    for(const auto& position : positions)
+    {
+        for(const auto& move : position.second)
+        {
+            if(move.second < min_weight)
+                continue;
+
+            BookEntry entry = {};
+            entry.key = position.first;
+            entry.point = move.first;
+            entry.weight = move.second;
+            book.push_back(entry);
+        }
+    }
+
+    std::sort(book.begin(), book.end(),
+        [](const BookEntry& e1, const BookEntry& e2)
+        {
+            if(e1.key != e2.key)
+                return e1.key < e2.key;
+            return e1.weight > e2.weight;
+        });
+
+    FILE *out = fopen(path.c_str(), "wb");
+    if(out == nullptr)
+        return false;
+
+    BookFileHeader header = {};
+    memcpy(header.magic, kBookMagic, 4);
+    header.version = kBookVersion;
+    header.nr_entries = book.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    if(!book.empty())
+        ok = ok && fwrite(book.data(), sizeof(BookEntry), book.size(), out) == book.size();
+
+    return (fclose(out) == 0) && ok;
+}
+
+int64_t BuildOpeningBook(const std::string& record_path, const std::string& book_path, int max_plies)
+{
+    RecordReader reader;
+    if(!reader.Open(record_path))
+        return -1;
+
+    OpeningBookBuilder builder;
+
+    GameRecord record;
+    for(uint64_t i = 0; i < reader.NumGames(); ++i)
+    {
+        if(reader.GetGame(i, &record))
+            builder.AddGame(record, max_plies);
+    }
+
+    if(!builder.Write(book_path))
+        return -1;
+
+    OpeningBook book;
+    if(!book.Open(book_path))
+        return -1;
+
+    return book.NumEntries();
+}
@@ -0,0 +1,101 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+#include "game_record.h"
+#include "mapped_file.h"
+
+// An opening book maps positions to weighted moves.
+//
+// Positions are keyed by their canonical hash, the
+// smallest hash over the 8 board symmetries, and moves
+// are stored in the orientation of that hash. That way
+// all rotated and mirrored versions of a position share
+// the same entries.
+//
+// The book file is a BookFileHeader followed by
+// BookEntry records sorted by key, so that lookups can
+// binary search the memory mapped file directly.
+
+const char kBookMagic[4] = {'G','O','B','K'};
+const uint32_t kBookVersion = 1;
+const int kDefaultBookPlies = 12;
+
+#pragma pack(push, 1)
+struct BookFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t nr_entries;
+};
+
+struct BookEntry
+{
+    uint64_t key;
+
+    // 1d point in the canonical orientation.
+    uint8_t point;
+    uint8_t reserved[3];
+
+    uint32_t weight;
+};
+#pragma pack(pop)
+
+struct BookMove
+{
+    Coordinate point;
+    uint32_t weight;
+};
+
+class OpeningBook
+{
+public:
+    // Maps the book file. Returns false if the
+    // file couldn't be mapped or isn't a book.
+    bool Open(const std::string& path);
+
+    bool Loaded() const { return entries != nullptr; }
+    uint64_t NumEntries() const { return nr_entries; }
+
+    // Gets the book moves for the position, with
+    // the highest weight first. The moves are in the
+    // orientation of the given board.
+    void GetMoves(const Board& board, std::vector<BookMove> *moves) const;
+
+    // Gets the book move with the highest weight.
+    // Returns false if the position is not in the book.
+    bool Probe(const Board& board, Coordinate *move) const;
+
+private:
+    MappedFile file;
+    const BookEntry *entries = nullptr;
+    uint64_t nr_entries = 0;
+};
+
+// Builds book files from game records.
+class OpeningBookBuilder
+{
+public:
+    // Adds the first max_plies moves of the game.
+    // Moves by the side that went on to win the
+    // game count twice.
+    void AddGame(const GameRecord& record, int max_plies = kDefaultBookPlies);
+
+    // Writes the moves that were seen at least
+    // min_weight times to a book file.
+    bool Write(const std::string& path, uint32_t min_weight = 2);
+
+private:
+    std::unordered_map<uint64_t, std::unordered_map<int,uint32_t>> positions;
+};
+
+// Builds a book from all the games of a record file.
+// Returns the number of book entries or -1 on failure.
+int64_t BuildOpeningBook(const std::string& record_path, const std::string& book_path, int max_plies = kDefaultBookPlies);
+
+#endif
@@ -0,0 +1,439 @@
+#include "ownership.h"
+#include "benson.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+namespace
+{
+    const int kWidth = kBoardSize + 2;
+    const int kPoints = kWidth*kWidth;
+    const int kDirections[4] = {-1, 1, -kWidth, kWidth};
+    const int kDiagonals[4] = {-kWidth - 1, -kWidth + 1, kWidth - 1, kWidth + 1};
+
+    // Playouts are run in chunks of this many
+    // playouts, each chunk with its own seed.
+    const int kPlayoutsPerChunk = 32;
+
+    // Playouts that reach this many moves are
+    // scored as they stand.
+    const int kMaxPlayoutMoves = 3*kBoardSize*kBoardSize;
+
+    enum { PLAYOUT_BORDER = 3 };
+
+    int Opponent(int color)
+    {
+        return (color == BLACK)?WHITE:BLACK;
+    }
+
+    int Point(const Coordinate& c)
+    {
+        return (c.y + 1)*kWidth + c.x + 1;
+    }
+
+    // Points owned by each side over the playouts
+    // of a chunk, indexed by Coordinate::As1D.
+    struct OwnershipCounts
+    {
+        std::array<int,kBoardSize*kBoardSize> black = {{0}};
+        std::array<int,kBoardSize*kBoardSize> white = {{0}};
+    };
+
+    // A minimal board for random playouts. Captures, suicide
+    // and simple ko are handled, nothing else is tracked.
+    class PlayoutBoard
+    {
+    public:
+        void Load(const Board& board)
+        {
+            points.fill(PLAYOUT_BORDER);
+            empty.clear();
+
+            for(int x = 0; x < kBoardSize; ++x)
+            {
+                for(int y = 0; y < kBoardSize; ++y)
+                {
+                    int point = Point({x,y});
+                    points[point] = board.GetStone(x,y);
+                    if(points[point] == EMPTY)
+                        AddEmpty(point);
+                }
+            }
+
+            Coordinate ko;
+            ko_point = board.GetKoPoint(&ko)?Point(ko):-1;
+            side_to_move = board.GetSideToMove();
+        }
+
+        // Plays random moves until both sides pass.
+        void Playout(std::mt19937 *rng)
+        {
+            int passes = 0;
+            for(int move = 0; move < kMaxPlayoutMoves && passes < 2; ++move)
+            {
+                passes = PlayRandomMove(rng)?0:passes + 1;
+                side_to_move = Opponent(side_to_move);
+            }
+        }
+
+        // Area scoring: stones and empty points
+        // that only touch one color.
+        void Score(OwnershipCounts *counts) const
+        {
+            for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+            {
+                int point = Point(Coordinate::Get2dCoordinate(i));
+                int owner = points[point];
+
+                if(owner == EMPTY)
+                {
+                    bool black = false;
+                    bool white = false;
+                    for(int direction : kDirections)
+                    {
+                        black |= points[point + direction] == BLACK;
+                        white |= points[point + direction] == WHITE;
+                    }
+                    owner = (black == white)?EMPTY:(black?BLACK:WHITE);
+                }
+
+                if(owner == BLACK)
+                    ++counts->black[i];
+                else if(owner == WHITE)
+                    ++counts->white[i];
+            }
+        }
+
+    private:
+        // Tries the empty points in random order. Returns
+        // false, for a pass, if none can be played.
+        bool PlayRandomMove(std::mt19937 *rng)
+        {
+            int untried = static_cast<int>(empty.size());
+            while(untried > 0)
+            {
+                int i = (*rng)() % untried;
+                int point = empty[i];
+
+                if(!IsOwnEye(point, side_to_move) && Play(point, side_to_move))
+                    return true;
+
+                // Keep the untried points at the front.
+                --untried;
+                std::swap(empty[i], empty[untried]);
+                empty_index[empty[i]] = i;
+                empty_index[empty[untried]] = untried;
+            }
+
+            return false;
+        }
+
+        // A point surrounded by the color that the opponent
+        // can't make false with the diagonals.
+        bool IsOwnEye(int point, int color) const
+        {
+            bool edge = false;
+            for(int direction : kDirections)
+            {
+                int stone = points[point + direction];
+                if(stone == PLAYOUT_BORDER)
+                    edge = true;
+                else if(stone != color)
+                    return false;
+            }
+
+            int opponent_diagonals = 0;
+            for(int diagonal : kDiagonals)
+                opponent_diagonals += points[point + diagonal] == Opponent(color);
+
+            return opponent_diagonals < (edge?1:2);
+        }
+
+        bool Play(int point, int color)
+        {
+            if(point == ko_point)
+                return false;
+
+            int opponent = Opponent(color);
+            points[point] = color;
+
+            int captured = 0;
+            int captured_point = -1;
+            for(int direction : kDirections)
+            {
+                int n = point + direction;
+                if(points[n] == opponent && !HasLiberty(n))
+                {
+                    captured += Capture(n);
+                    captured_point = n;
+                }
+            }
+
+            if(captured == 0 && !HasLiberty(point))
+            {
+                points[point] = EMPTY;
+                return false;
+            }
+
+            RemoveEmpty(point);
+
+            // A single stone that took a single stone and
+            // is left in atari can't be taken back at once.
+            ko_point = -1;
+            if(captured == 1)
+            {
+                int liberties = 0;
+                bool alone = true;
+                for(int direction : kDirections)
+                {
+                    liberties += points[point + direction] == EMPTY;
+                    alone &= points[point + direction] != color;
+                }
+
+                if(alone && liberties == 1)
+                    ko_point = captured_point;
+            }
+
+            return true;
+        }
+
+        bool HasLiberty(int point)
+        {
+            int color = points[point];
+
+            NextStamp();
+            stack.clear();
+            stack.push_back(point);
+            marks[point] = stamp;
+
+            while(!stack.empty())
+            {
+                int p = stack.back();
+                stack.pop_back();
+
+                for(int direction : kDirections)
+                {
+                    int n = p + direction;
+                    if(points[n] == EMPTY)
+                        return true;
+
+                    if(points[n] == color && marks[n] != stamp)
+                    {
+                        marks[n] = stamp;
+                        stack.push_back(n);
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        // Removes the group and returns its size.
+        int Capture(int point)
+        {
+            int color = points[point];
+            int count = 0;
+
+            stack.clear();
+            stack.push_back(point);
+            points[point] = EMPTY;
+
+            while(!stack.empty())
+            {
+                int p = stack.back();
+                stack.pop_back();
+
+                AddEmpty(p);
+                ++count;
+
+                for(int direction : kDirections)
+                {
+                    int n = p + direction;
+                    if(points[n] == color)
+                    {
+                        points[n] = EMPTY;
+                        stack.push_back(n);
+                    }
+                }
+            }
+
+            return count;
+        }
+
+        void AddEmpty(int point)
+        {
+            empty_index[point] = static_cast<int>(empty.size());
+            empty.push_back(point);
+        }
+
+        void RemoveEmpty(int point)
+        {
+            int i = empty_index[point];
+            empty[i] = empty.back();
+            empty_index[empty[i]] = i;
+            empty.pop_back();
+        }
+
+        void NextStamp()
+        {
+            if(++stamp == 0)
+            {
+                marks.fill(0);
+                stamp = 1;
+            }
+        }
+
+        std::array<int8_t,kPoints> points;
+        int ko_point = -1;
+        int side_to_move = BLACK;
+
+        // The empty points in no particular order and
+        // where each one is in the list.
+        std::vector<int> empty;
+        std::array<int,kPoints> empty_index;
+
+        std::array<uint32_t,kPoints> marks = {{0}};
+        uint32_t stamp = 0;
+        std::vector<int> stack;
+    };
+
+    OwnershipCounts RunChunk(const Board& board, int playouts, uint32_t seed)
+    {
+        OwnershipCounts counts;
+        std::mt19937 rng(seed);
+
+        PlayoutBoard playout;
+        for(int i = 0; i < playouts; ++i)
+        {
+            playout.Load(board);
+            playout.Playout(&rng);
+            playout.Score(&counts);
+        }
+
+        return counts;
+    }
+}
+
+int OwnershipMap::Owner(const Coordinate& c, float threshold) const
+{
+    float value = ownership[c.As1D()];
+    if(value >= threshold)
+        return BLACK;
+    if(value <= -threshold)
+        return WHITE;
+    return EMPTY;
+}
+
+void EstimateOwnership(const Board& board, const OwnershipOptions& options, OwnershipMap *map)
+{
+    PROFILE_ZONE("EstimateOwnership");
+
+    int playouts = std::max(1, options.playouts);
+    int chunks = (playouts + kPlayoutsPerChunk - 1)/kPlayoutsPerChunk;
+
+    auto chunk_playouts = [&](int chunk) { return std::min(kPlayoutsPerChunk, playouts - chunk*kPlayoutsPerChunk); };
+    auto chunk_seed = [&](int chunk) { return options.seed + 0x9E3779B9u*static_cast<uint32_t>(chunk); };
+
+    std::vector<OwnershipCounts> results;
+
+    int threads = (options.threads > 0)?options.threads:static_cast<int>(std::thread::hardware_concurrency());
+    if(threads <= 1)
+    {
+        for(int chunk = 0; chunk < chunks; ++chunk)
+            results.push_back(RunChunk(board, chunk_playouts(chunk), chunk_seed(chunk)));
+    }
+    else
+    {
+        ThreadPool pool(threads, chunks);
+
+        std::vector<std::future<OwnershipCounts>> futures;
+        for(int chunk = 0; chunk < chunks; ++chunk)
+        {
+            int n = chunk_playouts(chunk);
+            uint32_t seed = chunk_seed(chunk);
+            futures.push_back(pool.Submit([&board, n, seed]() { return RunChunk(board, n, seed); }));
+        }
+
+        for(auto& future : futures)
+            results.push_back(future.get());
+    }
+
+    OwnershipCounts total;
+    for(const OwnershipCounts& counts : results)
+    {
+        for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+        {
+            total.black[i] += counts.black[i];
+            total.white[i] += counts.white[i];
+        }
+    }
+
+    SafeAreas safe;
+    FindSafeAreas(board, &safe);
+
+    for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+    {
+        if(safe[i] != EMPTY)
+            map->ownership[i] = (safe[i] == BLACK)?1:-1;
+        else
+            map->ownership[i] = static_cast<float>(total.black[i] - total.white[i])/playouts;
+    }
+}
+
+void FindDeadStones(const Board& board, const OwnershipMap& map, float threshold, std::vector<Coordinate> *dead)
+{
+    dead->clear();
+
+    // The groups of the board may be stale,
+    // so they are walked from the stones.
+    std::array<bool,kBoardSize*kBoardSize> visited = {{false}};
+
+    for(int i = 0; i < kBoardSize*kBoardSize; ++i)
+    {
+        Coordinate start = Coordinate::Get2dCoordinate(i);
+        int color = board.GetStone(start.x, start.y);
+        if(color == EMPTY || visited[i])
+            continue;
+
+        std::vector<Coordinate> stones = {start};
+        visited[i] = true;
+
+        float sum = 0;
+        for(size_t j = 0; j < stones.size(); ++j)
+        {
+            Coordinate c = stones[j];
+            sum += map.ownership[c.As1D()];
+
+            const Coordinate neighbors[4] = {{c.x-1,c.y},{c.x+1,c.y},{c.x,c.y-1},{c.x,c.y+1}};
+            for(const Coordinate& n : neighbors)
+            {
+                if(n.x < 0 || n.y < 0 || n.x >= kBoardSize || n.y >= kBoardSize)
+                    continue;
+
+                if(!visited[n.As1D()] && board.GetStone(n.x, n.y) == color)
+                {
+                    visited[n.As1D()] = true;
+                    stones.push_back(n);
+                }
+            }
+        }
+
+        // Towards the color's side is positive.
+        float average = sum/stones.size();
+        if(color == WHITE)
+            average = -average;
+
+        if(average <= -threshold)
+            dead->insert(dead->end(), stones.begin(), stones.end());
+    }
+}
+
+void FindDeadStones(const Board& board, const OwnershipOptions& options, std::vector<Coordinate> *dead)
+{
+    OwnershipMap map;
+    EstimateOwnership(board, options, &map);
+    FindDeadStones(board, map, options.dead_threshold, dead);
+}
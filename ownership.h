@@ -0,0 +1,60 @@
+#ifndef OWNERSHIP_H
+#define OWNERSHIP_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+
+// Estimates who owns each point of a finished game.
+//
+// Many random playouts are run from the position on a
+// light board of its own. Neither side fills its own
+// single point eyes, so the playouts end with the groups
+// that can live alive and the rest captured. Each point is
+// scored by area at the end of every playout and the
+// results are averaged. The pass-alive areas of the board
+// are owned for sure and are not left to chance.
+//
+// Playouts are run in fixed chunks, each with its own
+// random numbers, so the estimate only depends on the
+// seed and not on the number of threads.
+
+struct OwnershipOptions
+{
+    int playouts = 1000;
+
+    // 0 uses all hardware threads.
+    int threads = 1;
+
+    uint32_t seed = 1;
+
+    // A group is dead if the ownership of its stones,
+    // averaged, is at least this far on the opponent's side.
+    float dead_threshold = 0.5;
+};
+
+struct OwnershipMap
+{
+    // For each point, indexed by Coordinate::As1D, the share
+    // of playouts black owns it minus the share white owns it.
+    // From -1 for white to 1 for black.
+    std::array<float,kBoardSize*kBoardSize> ownership;
+
+    // The owner of a point if its ownership is at least
+    // threshold towards one side, else EMPTY.
+    int Owner(const Coordinate& c, float threshold) const;
+};
+
+void EstimateOwnership(const Board& board, const OwnershipOptions& options, OwnershipMap *map);
+
+// The stones of the groups the estimate calls dead. The
+// stones of a group are judged together, by their average
+// ownership.
+void FindDeadStones(const Board& board, const OwnershipMap& map, float threshold, std::vector<Coordinate> *dead);
+
+// Estimates the ownership and finds the dead stones.
+void FindDeadStones(const Board& board, const OwnershipOptions& options, std::vector<Coordinate> *dead);
+
+#endif
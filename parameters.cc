@@ -0,0 +1,145 @@
+#include "parameters.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+    // A parameter of the config file, either a float
+    // or an int one.
+    struct Field
+    {
+        const char *name;
+        float Parameters::*float_value;
+        int Parameters::*int_value;
+    };
+
+    const Field kEvaluationFields[] =
+    {
+        {"captures_weight", &Parameters::captures_weight, nullptr},
+        {"territory_weight", &Parameters::territory_weight, nullptr},
+        {"liberties_weight", &Parameters::liberties_weight, nullptr},
+        {"influence_weight", &Parameters::influence_weight, nullptr},
+        {"point_evaluation", nullptr, &Parameters::point_evaluation},
+        {"edge_point_evaluation", nullptr, &Parameters::edge_point_evaluation},
+    };
+
+    const Field kSearchFields[] =
+    {
+        {"search_depth", nullptr, &Parameters::search_depth},
+        {"moves_to_consider", nullptr, &Parameters::moves_to_consider},
+        {"progressive_widening", nullptr, &Parameters::progressive_widening},
+        {"root_moves_to_consider", nullptr, &Parameters::root_moves_to_consider},
+        {"max_moves_to_consider", nullptr, &Parameters::max_moves_to_consider},
+        {"min_moves_to_consider", nullptr, &Parameters::min_moves_to_consider},
+        {"policy_coverage", &Parameters::policy_coverage, nullptr},
+    };
+
+    const Field* FindField(const std::string& name)
+    {
+        for(const Field& field : kEvaluationFields)
+        {
+            if(name == field.name)
+                return &field;
+        }
+
+        for(const Field& field : kSearchFields)
+        {
+            if(name == field.name)
+                return &field;
+        }
+
+        return nullptr;
+    }
+
+    // Sets the named parameter. Returns false if the
+    // name is unknown or the value isn't a number.
+    bool SetParameter(const std::string& name, const std::string& value, Parameters *parameters)
+    {
+        const Field *field = FindField(name);
+        if(field == nullptr)
+            return false;
+
+        std::istringstream in(value);
+        if(field->float_value != nullptr)
+            in>>parameters->*field->float_value;
+        else
+            in>>parameters->*field->int_value;
+
+        return in && (in>>std::ws).eof();
+    }
+
+    template<size_t N>
+    void WriteSection(std::ostream& out, const char *title, const Field (&fields)[N], const Parameters& parameters)
+    {
+        out<<"# "<<title<<"\n";
+        for(const Field& field : fields)
+        {
+            // Enough digits to read back the same float.
+            if(field.float_value != nullptr)
+                out<<field.name<<" = "<<std::setprecision(std::numeric_limits<float>::max_digits10)<<parameters.*field.float_value<<"\n";
+            else
+                out<<field.name<<" = "<<parameters.*field.int_value<<"\n";
+        }
+    }
+
+    std::string Trim(const std::string& text)
+    {
+        size_t first = text.find_first_not_of(" \t\r");
+        if(first == std::string::npos)
+            return "";
+
+        size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+}
+
+bool LoadParameters(const std::string& path, Parameters *parameters)
+{
+    std::ifstream in(path);
+    if(!in)
+        return false;
+
+    Parameters loaded = *parameters;
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        line = Trim(line);
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        size_t equals = line.find('=');
+        if(equals == std::string::npos)
+            return false;
+
+        if(!SetParameter(Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)), &loaded))
+            return false;
+    }
+
+    *parameters = loaded;
+    return true;
+}
+
+bool SaveParameters(const std::string& path, const Parameters& parameters)
+{
+    std::string temporary_path = path + ".tmp";
+
+    {
+        std::ofstream out(temporary_path);
+        if(!out)
+            return false;
+
+        WriteSection(out, "Evaluation", kEvaluationFields, parameters);
+        out<<"\n";
+        WriteSection(out, "Search", kSearchFields, parameters);
+
+        if(!out.flush())
+            return false;
+    }
+
+    return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+}
@@ -1,11 +1,13 @@
 #ifndef PARAMETERS_H
 #define PARAMETERS_H
 
+#include <string>
+
 /* Evaluation */
-const int kCapturesWeight = 1;
-const int kTerritoryWeight = 1;
-const int kLibertiesWeight = 1;
-const int kInfluenceWeight = 1;
+const float kCapturesWeight = 1;
+const float kTerritoryWeight = 1;
+const float kLibertiesWeight = 1;
+const float kInfluenceWeight = 1;
 
 const int kPointEvaluation = 1;
 const int kEdgePointEvaluation = 3;
@@ -14,4 +16,60 @@ const int kEdgePointEvaluation = 3;
 const int kSearchDepth = 6;
 const int kMovesToConsider = 8;
 
+// Progressive widening, see Ai::MovesToConsider.
+const int kProgressiveWidening = 1;
+const int kRootMovesToConsider = 12;
+const int kMaxMovesToConsider = 10;
+const int kMinMovesToConsider = 3;
+const float kPolicyCoverage = 0.9;
+
+// The values above as a struct, so that they
+// can be changed at runtime and tuned. Boards
+// evaluate with the defaults unless they are
+// given some other parameters.
+struct Parameters
+{
+    float captures_weight = kCapturesWeight;
+    float territory_weight = kTerritoryWeight;
+    float liberties_weight = kLibertiesWeight;
+    float influence_weight = kInfluenceWeight;
+
+    int point_evaluation = kPointEvaluation;
+    int edge_point_evaluation = kEdgePointEvaluation;
+
+    int search_depth = kSearchDepth;
+    int moves_to_consider = kMovesToConsider;
+
+    // With progressive widening off every node searches
+    // moves_to_consider moves. With it on the root searches
+    // root_moves_to_consider, the nodes below it start at
+    // max_moves_to_consider and narrow down to min_moves_to_consider
+    // towards the leaves. With a policy, nodes where fewer moves
+    // than that hold policy_coverage of the probability only
+    // search those.
+    int progressive_widening = kProgressiveWidening;
+    int root_moves_to_consider = kRootMovesToConsider;
+    int max_moves_to_consider = kMaxMovesToConsider;
+    int min_moves_to_consider = kMinMovesToConsider;
+    float policy_coverage = kPolicyCoverage;
+};
+
+const Parameters kDefaultParameters;
+
+// Reads parameters from a config file of
+// "name = value" lines. Names are the member
+// names of Parameters, lines starting with #
+// are comments and missing names keep their
+// current value. Returns false if the file
+// couldn't be read or has an unknown name or
+// a bad value, the parameters are left as they
+// were in that case.
+bool LoadParameters(const std::string& path, Parameters *parameters);
+
+// Writes all the parameters in the format read
+// by LoadParameters. The file is replaced in a
+// single rename so that readers never see half
+// of it.
+bool SaveParameters(const std::string& path, const Parameters& parameters);
+
 #endif
@@ -0,0 +1,154 @@
+#include "pattern.h"
+#include "symmetry.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // Index of the neighbor at the given offset.
+    int NeighborIndex(int dx, int dy)
+    {
+        for(int i = 0; i < 8; ++i)
+        {
+            if(Pattern::kNeighborX[i] == dx && Pattern::kNeighborY[i] == dy)
+                return i;
+        }
+        return -1;
+    }
+
+    // Orthogonal neighbors: above, left, right and below.
+    const int kOrthogonal[4] = {1, 3, 4, 6};
+
+    // For an edge point with the orthogonal neighbor
+    // kOrthogonal[k] off the board, the three neighbors
+    // on the next line away from the edge.
+    const int kSecondLine[4][3] = {{5, 6, 7}, {2, 4, 7}, {0, 3, 5}, {0, 1, 2}};
+
+    uint16_t CalculateProperties(uint16_t code)
+    {
+        uint16_t properties = 0;
+
+        int off_board = 0;
+        int edge_side = -1;
+        for(int k = 0; k < 4; ++k)
+        {
+            int value = Pattern::Neighbor(code, kOrthogonal[k]);
+            if(value == EMPTY)
+                ++properties;
+            else if(value == PATTERN_EDGE)
+            {
+                ++off_board;
+                edge_side = k;
+            }
+        }
+
+        if(off_board == 2)
+            properties |= PATTERN_CORNER_POINT;
+
+        if(off_board == 1)
+        {
+            properties |= PATTERN_EDGE_POINT;
+
+            for(int i : kSecondLine[edge_side])
+            {
+                int value = Pattern::Neighbor(code, i);
+                if(value == BLACK)
+                    properties |= PATTERN_BLACK_ON_SECOND_LINE;
+                else if(value == WHITE)
+                    properties |= PATTERN_WHITE_ON_SECOND_LINE;
+            }
+        }
+
+        return properties;
+    }
+
+    struct PatternTables
+    {
+        std::vector<uint16_t> swapped;
+        std::vector<uint16_t> canonical;
+        std::vector<uint16_t> properties;
+
+        PatternTables() : swapped(kNumPatterns), canonical(kNumPatterns), properties(kNumPatterns)
+        {
+            // Where each neighbor goes under each symmetry.
+            // The symmetries of symmetry.h act on the board,
+            // so they are applied around the center point.
+            const int center = kBoardSize/2;
+            int moved[kNumSymmetries][8];
+            for(int s = 0; s < kNumSymmetries; ++s)
+            {
+                for(int i = 0; i < 8; ++i)
+                {
+                    Coordinate c = TransformPoint({center + Pattern::kNeighborX[i], center + Pattern::kNeighborY[i]}, s);
+                    moved[s][i] = NeighborIndex(c.x - center, c.y - center);
+                }
+            }
+
+            for(int code = 0; code < kNumPatterns; ++code)
+            {
+                uint16_t swap = 0;
+                uint16_t best = code;
+
+                for(int i = 0; i < 8; ++i)
+                {
+                    int value = Pattern::Neighbor(code, i);
+                    if(value == BLACK || value == WHITE)
+                        value = BLACK + WHITE - value;
+                    swap |= value << (2*i);
+                }
+
+                for(int s = 1; s < kNumSymmetries; ++s)
+                {
+                    uint16_t transformed = 0;
+                    for(int i = 0; i < 8; ++i)
+                        transformed |= Pattern::Neighbor(code, i) << (2*moved[s][i]);
+
+                    best = std::min(best, transformed);
+                }
+
+                swapped[code] = swap;
+                canonical[code] = best;
+                properties[code] = CalculateProperties(code);
+            }
+        }
+    };
+
+    const PatternTables& Tables()
+    {
+        static const PatternTables tables;
+        return tables;
+    }
+}
+
+uint16_t Pattern::Compute(const Board& board, const Coordinate& c)
+{
+    uint16_t code = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        int x = c.x + kNeighborX[i];
+        int y = c.y + kNeighborY[i];
+
+        int value = PATTERN_EDGE;
+        if(x >= 0 && x < kBoardSize && y >= 0 && y < kBoardSize)
+            value = board.GetStone(x,y);
+
+        code |= value << (2*i);
+    }
+    return code;
+}
+
+uint16_t Pattern::SwapColors(uint16_t code)
+{
+    return Tables().swapped[code];
+}
+
+uint16_t Pattern::Canonical(uint16_t code)
+{
+    return Tables().canonical[code];
+}
+
+uint16_t Pattern::Properties(uint16_t code)
+{
+    return Tables().properties[code];
+}
@@ -0,0 +1,76 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <cstdint>
+
+#include "board.h"
+
+// The 3x3 neighborhood of a point as a 16 bit code.
+// Each of the 8 neighbors takes two bits, EMPTY, BLACK,
+// WHITE or PATTERN_EDGE for points off the board. The
+// neighbors are numbered row by row, skipping the point
+// itself:
+//
+//   0 1 2
+//   3 . 4
+//   5 6 7
+
+const int kNumPatterns = 65536;
+const int PATTERN_EDGE = 3;
+
+// Shape properties of a pattern, see Pattern::Properties.
+enum PatternProperty
+{
+    // The number of empty points next to the
+    // point is kept in the lowest three bits.
+    PATTERN_LIBERTIES = 7,
+
+    // One side or two sides of the point are off
+    // the board, i.e. it is an edge or a corner point.
+    PATTERN_EDGE_POINT = 8,
+    PATTERN_CORNER_POINT = 16,
+
+    // Edge points with a stone of the color on one
+    // of the three points on the second line next
+    // to them.
+    PATTERN_BLACK_ON_SECOND_LINE = 32,
+    PATTERN_WHITE_ON_SECOND_LINE = 64
+};
+
+namespace Pattern
+{
+    // Offsets of the 8 neighbors in code order.
+    const int kNeighborX[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+    const int kNeighborY[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+    inline int Neighbor(uint16_t code, int i) { return (code >> (2*i)) & 3; }
+
+    // Index of the neighbor on the other side, i.e.
+    // neighbor i of a point sees the point as 7 - i.
+    inline int Opposite(int i) { return 7 - i; }
+
+    // Reads the code of a point from the board.
+    // Boards keep the codes of all points up to
+    // date, see Board::GetPattern.
+    uint16_t Compute(const Board& board, const Coordinate& c);
+
+    // A bit set of PatternProperty for the code.
+    uint16_t Properties(uint16_t code);
+
+    inline int Liberties(uint16_t properties) { return properties & PATTERN_LIBERTIES; }
+
+    inline uint16_t SecondLineProperty(int side)
+    {
+        return (side == BLACK)?PATTERN_BLACK_ON_SECOND_LINE:PATTERN_WHITE_ON_SECOND_LINE;
+    }
+
+    // The code with black and white swapped, so that
+    // patterns can be seen from the side to move.
+    uint16_t SwapColors(uint16_t code);
+
+    // The smallest code over the 8 rotations and
+    // reflections of the pattern.
+    uint16_t Canonical(uint16_t code);
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "perft.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Collects the legal moves of the position.
+static void LegalMoves(Board *board, bool include_passes, std::vector<Coordinate> *moves)
+{
+    moves->clear();
+
+    for(int y = 0; y < kBoardSize; ++y)
+    {
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            if(board->Occupied({x,y}) || !board->MakeMove({x,y}))
+                continue;
+
+            board->UndoLastMove();
+            moves->push_back({x,y});
+        }
+    }
+
+    if(include_passes)
+    {
+        board->Pass();
+        if(!board->EndGame())
+            moves->push_back(kPassMove);
+        board->UndoLastMove();
+    }
+}
+
+static void PlayMove(Board *board, const Coordinate& move)
+{
+    if(move == kPassMove)
+        board->Pass();
+    else
+        board->MakeMove(move);
+}
+
+uint64_t Perft(Board *board, int depth, bool include_passes)
+{
+    if(depth == 0)
+        return 1;
+
+    uint64_t nodes = 0;
+
+    for(int y = 0; y < kBoardSize; ++y)
+    {
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            if(board->Occupied({x,y}) || !board->MakeMove({x,y}))
+                continue;
+
+            nodes += (depth == 1)?1:Perft(board, depth - 1, include_passes);
+            board->UndoLastMove();
+        }
+    }
+
+    if(include_passes)
+    {
+        board->Pass();
+        if(!board->EndGame())
+            nodes += (depth == 1)?1:Perft(board, depth - 1, include_passes);
+        board->UndoLastMove();
+    }
+
+    return nodes;
+}
+
+PerftResult RunPerft(const Board& board, const PerftOptions& options)
+{
+    PerftResult result;
+
+    auto start = std::chrono::steady_clock::now();
+
+    Board root = board;
+    std::vector<Coordinate> root_moves;
+    LegalMoves(&root, options.include_passes, &root_moves);
+
+    result.divide.resize(root_moves.size());
+    for(size_t i = 0; i < root_moves.size(); ++i)
+        result.divide[i] = {root_moves[i], 0};
+
+    if(options.depth > 0)
+    {
+        // The threads pick root moves one at a time so that
+        // a few big subtrees don't leave the others idle.
+        std::atomic<size_t> next_move{0};
+
+        auto worker = [&]()
+        {
+            Board local = board;
+
+            size_t i;
+            while((i = next_move++) < root_moves.size())
+            {
+                PlayMove(&local, root_moves[i]);
+                result.divide[i].second = Perft(&local, options.depth - 1, options.include_passes);
+                local.UndoLastMove();
+            }
+        };
+
+        int nr_threads = std::max(1, options.threads);
+
+        std::vector<std::thread> threads;
+        for(int i = 1; i < nr_threads; ++i)
+            threads.emplace_back(worker);
+
+        worker();
+
+        for(auto& thread : threads)
+            thread.join();
+
+        for(const auto& entry : result.divide)
+            result.nodes += entry.second;
+    }
+    else
+        result.nodes = 1;
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+
+// Perft counts the leaf nodes of the tree of legal
+// moves to a fixed depth. Every empty point is tried
+// with MakeMove, so ko and suicide are handled exactly
+// like in a game. The counts are a correctness oracle
+// for changes to the board representation and the
+// time taken is a raw make/undo throughput number.
+
+struct PerftOptions
+{
+    int depth = 3;
+    int threads = 1;
+
+    // Passes are counted as moves, except for the
+    // second pass in a row which would end the game.
+    bool include_passes = false;
+};
+
+struct PerftResult
+{
+    uint64_t nodes = 0;
+    double seconds = 0;
+
+    // Leaf counts below each root move, in the
+    // order of the root moves. Passes are kPassMove.
+    std::vector<std::pair<Coordinate,uint64_t>> divide;
+};
+
+// Counts the leaves below the position. The board is
+// returned in the same state it was given in.
+uint64_t Perft(Board *board, int depth, bool include_passes);
+
+// Runs perft with the root moves split over threads.
+PerftResult RunPerft(const Board& board, const PerftOptions& options);
+
+#endif
@@ -0,0 +1,430 @@
+#include "policy.h"
+#include "game_record.h"
+#include "record_file.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace
+{
+    const int kNumPoints = kBoardSize*kBoardSize;
+
+    typedef std::bitset<kNumPoints> PointSet;
+
+    // The groups of both sides by point.
+    struct GroupMap
+    {
+        int group_at[kNumPoints];
+        std::vector<PointSet> liberties;
+        std::vector<int> nr_liberties;
+
+        explicit GroupMap(const Board& board)
+        {
+            std::fill(group_at, group_at + kNumPoints, -1);
+
+            for(int side : {BLACK, WHITE})
+            {
+                for(const Group& group : board.GetGroups(side))
+                {
+                    int index = static_cast<int>(liberties.size());
+
+                    PointSet points;
+                    for(const Coordinate& c : group.liberties)
+                        points.set(c.As1D());
+
+                    liberties.push_back(points);
+                    nr_liberties.push_back(static_cast<int>(group.liberties.size()));
+
+                    for(const Coordinate& c : group.stones)
+                        group_at[c.As1D()] = index;
+                }
+            }
+        }
+    };
+
+    int TacticalFlags(const Board& board, const GroupMap& groups, const Coordinate& c, int side)
+    {
+        int flags = 0;
+        PointSet new_liberties;
+
+        const int dx[4] = {-1, 1, 0, 0};
+        const int dy[4] = {0, 0, -1, 1};
+        for(int k = 0; k < 4; ++k)
+        {
+            Coordinate n = {c.x + dx[k], c.y + dy[k]};
+            if(n.x < 0 || n.x >= kBoardSize || n.y < 0 || n.y >= kBoardSize)
+                continue;
+
+            int stone = board.GetStone(n.x, n.y);
+            if(stone == EMPTY)
+            {
+                new_liberties.set(n.As1D());
+                continue;
+            }
+
+            int group = groups.group_at[n.As1D()];
+            if(group < 0)
+                continue;
+
+            int liberties = groups.nr_liberties[group];
+            if(stone == side)
+            {
+                if(liberties == 1)
+                    flags |= POLICY_SAVE;
+                new_liberties |= groups.liberties[group];
+            }
+            else if(liberties == 1)
+                flags |= POLICY_CAPTURE;
+            else if(liberties == 2)
+                flags |= POLICY_ATARI;
+        }
+
+        new_liberties.reset(c.As1D());
+        if(!(flags & POLICY_CAPTURE) && new_liberties.count() <= 1)
+            flags |= POLICY_SELF_ATARI;
+
+        return flags;
+    }
+
+    // The empty regions that only touch stones of the side,
+    // its own territory. A single point eye is one of them.
+    PointSet OwnTerritory(const Board& board, int side)
+    {
+        PointSet territory;
+        PointSet visited;
+        std::vector<Coordinate> region;
+
+        const int dx[4] = {-1, 1, 0, 0};
+        const int dy[4] = {0, 0, -1, 1};
+        for(int i = 0; i < kNumPoints; ++i)
+        {
+            Coordinate start = Coordinate::Get2dCoordinate(i);
+            if(visited[i] || board.GetStone(start.x, start.y) != EMPTY)
+                continue;
+
+            region.assign(1, start);
+            visited.set(i);
+
+            bool own = false;
+            bool opponent = false;
+            for(size_t j = 0; j < region.size(); ++j)
+            {
+                Coordinate c = region[j];
+                for(int k = 0; k < 4; ++k)
+                {
+                    Coordinate n = {c.x + dx[k], c.y + dy[k]};
+                    if(n.x < 0 || n.x >= kBoardSize || n.y < 0 || n.y >= kBoardSize)
+                        continue;
+
+                    int stone = board.GetStone(n.x, n.y);
+                    if(stone == side)
+                        own = true;
+                    else if(stone != EMPTY)
+                        opponent = true;
+                    else if(!visited[n.As1D()])
+                    {
+                        visited.set(n.As1D());
+                        region.push_back(n);
+                    }
+                }
+            }
+
+            if(own && !opponent)
+            {
+                for(const Coordinate& c : region)
+                    territory.set(c.As1D());
+            }
+        }
+
+        return territory;
+    }
+
+    int DistanceBucket(const Coordinate& c, bool has_last_move, const Coordinate& last_move)
+    {
+        if(!has_last_move || last_move == kPassMove)
+            return 0;
+
+        int distance = std::abs(c.x - last_move.x) + std::abs(c.y - last_move.y);
+        return std::min(distance, kPolicyDistances - 1);
+    }
+
+    int Line(const Coordinate& c)
+    {
+        int line = std::min(std::min(c.x, c.y), std::min(kBoardSize - 1 - c.x, kBoardSize - 1 - c.y));
+        return std::min(line, kPolicyLines - 1);
+    }
+
+    // The candidates of one position and the
+    // index of the move that was played.
+    struct TrainingPosition
+    {
+        std::vector<PolicyFeatures> features;
+        int target;
+    };
+
+    void ExtractGame(const GameRecord& record, std::vector<TrainingPosition> *positions)
+    {
+        Board board;
+        std::vector<Coordinate> moves;
+
+        for(const Coordinate& move : record.moves)
+        {
+            if(move == kPassMove)
+            {
+                board.Pass();
+                continue;
+            }
+
+            TrainingPosition position;
+            MovePolicy::GetCandidates(&board, &moves, &position.features);
+
+            auto found = std::find(moves.begin(), moves.end(), move);
+            if(found != moves.end())
+            {
+                position.target = static_cast<int>(found - moves.begin());
+                positions->push_back(std::move(position));
+            }
+
+            if(!board.MakeMove(move))
+                return;
+        }
+    }
+}
+
+bool MovePolicy::Load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if(!in)
+        return false;
+
+    PolicyFileHeader header;
+    if(!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+
+    if(std::memcmp(header.magic, kPolicyMagic, 4) != 0 || header.version != kPolicyVersion)
+        return false;
+
+    if(header.nr_patterns != kNumPatterns || header.nr_contexts != kNumPolicyContexts)
+        return false;
+
+    std::vector<float> patterns(kNumPatterns);
+    std::vector<float> contexts(kNumPolicyContexts);
+    if(!in.read(reinterpret_cast<char*>(patterns.data()), patterns.size()*sizeof(float)) ||
+        !in.read(reinterpret_cast<char*>(contexts.data()), contexts.size()*sizeof(float)))
+        return false;
+
+    pattern_weights.swap(patterns);
+    context_weights.swap(contexts);
+    return true;
+}
+
+bool MovePolicy::Save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if(!out)
+        return false;
+
+    PolicyFileHeader header;
+    std::memcpy(header.magic, kPolicyMagic, 4);
+    header.version = kPolicyVersion;
+    header.nr_patterns = kNumPatterns;
+    header.nr_contexts = kNumPolicyContexts;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(pattern_weights.data()), pattern_weights.size()*sizeof(float));
+    out.write(reinterpret_cast<const char*>(context_weights.data()), context_weights.size()*sizeof(float));
+
+    return static_cast<bool>(out.flush());
+}
+
+void MovePolicy::GetCandidates(Board *board, std::vector<Coordinate> *moves, std::vector<PolicyFeatures> *features)
+{
+    PROFILE_ZONE("MovePolicy::GetCandidates");
+
+    moves->clear();
+    features->clear();
+
+    int side = board->GetSideToMove();
+    GroupMap groups(*board);
+
+    Coordinate last_move;
+    bool has_last_move = board->GetLastMove(&last_move);
+
+    Coordinate ko_point;
+    bool has_ko = board->GetKoPoint(&ko_point);
+
+    // The same points are left out as in Board::GenerateMoves.
+    PointSet territory = OwnTerritory(*board, side);
+    const SafeAreas& safe = board->GetSafeAreas();
+
+    for(int y = 0; y < kBoardSize; ++y)
+    {
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            Coordinate c = {x,y};
+            if(board->Occupied(c) || (has_ko && c == ko_point) || safe[c.As1D()] != EMPTY)
+                continue;
+
+            int flags = TacticalFlags(*board, groups, c, side);
+
+            // Don't fill your own territory unless a group
+            // in atari needs the point.
+            if(territory[c.As1D()] && !(flags & POLICY_SAVE))
+                continue;
+
+            uint16_t code = board->GetPattern(c);
+            if(side == WHITE)
+                code = Pattern::SwapColors(code);
+
+            int context = (flags*kPolicyDistances + DistanceBucket(c, has_last_move, last_move))*kPolicyLines + Line(c);
+
+            moves->push_back(c);
+            features->push_back({Pattern::Canonical(code), static_cast<uint16_t>(context)});
+        }
+    }
+}
+
+void MovePolicy::GenerateMoves(Board *board, std::vector<Coordinate> *moves, std::vector<float> *probabilities) const
+{
+    std::vector<Coordinate> candidates;
+    std::vector<PolicyFeatures> features;
+    GetCandidates(board, &candidates, &features);
+
+    std::vector<float> scores(candidates.size());
+    for(size_t i = 0; i < candidates.size(); ++i)
+        scores[i] = Score(features[i]);
+
+    std::vector<int> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+
+    moves->clear();
+    for(int i : order)
+        moves->push_back(candidates[i]);
+
+    if(probabilities == nullptr)
+        return;
+
+    probabilities->clear();
+    if(order.empty())
+        return;
+
+    float best = scores[order[0]];
+    float sum = 0;
+    for(int i : order)
+    {
+        probabilities->push_back(std::exp(scores[i] - best));
+        sum += probabilities->back();
+    }
+
+    for(float& p : *probabilities)
+        p /= sum;
+}
+
+bool TrainPolicy(const std::string& record_path, const std::string& policy_path, const PolicyTrainingOptions& options)
+{
+    RecordReader reader;
+    if(!reader.Open(record_path))
+        return false;
+
+    // Extract the candidates of every position once.
+    int nr_threads = std::max(1, options.threads);
+    std::vector<std::vector<TrainingPosition>> thread_positions(nr_threads);
+    std::atomic<uint64_t> next_game{0};
+
+    auto worker = [&](int thread)
+    {
+        GameRecord record;
+        uint64_t game;
+        while((game = next_game++) < reader.NumGames())
+        {
+            if(reader.GetGame(game, &record))
+                ExtractGame(record, &thread_positions[thread]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(int i = 1; i < nr_threads; ++i)
+        threads.emplace_back(worker, i);
+
+    worker(0);
+
+    for(auto& thread : threads)
+        thread.join();
+
+    std::vector<TrainingPosition> positions;
+    for(auto& part : thread_positions)
+    {
+        std::move(part.begin(), part.end(), std::back_inserter(positions));
+        std::vector<TrainingPosition>().swap(part);
+    }
+
+    std::cout<<"Training on "<<positions.size()<<" positions.\n";
+
+    MovePolicy policy;
+    std::mt19937 rng(1);
+    std::vector<size_t> order(positions.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::vector<float> probabilities;
+    for(int epoch = 0; epoch < options.epochs; ++epoch)
+    {
+        std::shuffle(order.begin(), order.end(), rng);
+        float learning_rate = options.learning_rate/(1 + epoch);
+
+        double loss = 0;
+        uint64_t correct = 0;
+
+        for(size_t index : order)
+        {
+            const TrainingPosition& position = positions[index];
+            const std::vector<PolicyFeatures>& features = position.features;
+
+            probabilities.resize(features.size());
+            float best = -1e30f;
+            size_t best_move = 0;
+            for(size_t i = 0; i < features.size(); ++i)
+            {
+                probabilities[i] = policy.Score(features[i]);
+                if(probabilities[i] > best)
+                {
+                    best = probabilities[i];
+                    best_move = i;
+                }
+            }
+
+            float sum = 0;
+            for(float& p : probabilities)
+            {
+                p = std::exp(p - best);
+                sum += p;
+            }
+
+            correct += (best_move == static_cast<size_t>(position.target));
+            loss -= std::log(std::max(1e-12f, probabilities[position.target]/sum));
+
+            // The gradient of the log loss is the probability
+            // of each candidate minus one for the played move.
+            for(size_t i = 0; i < features.size(); ++i)
+            {
+                float gradient = probabilities[i]/sum - (static_cast<int>(i) == position.target);
+                policy.pattern_weights[features[i].pattern] -= learning_rate*gradient;
+                policy.context_weights[features[i].context] -= learning_rate*gradient;
+            }
+        }
+
+        size_t n = std::max<size_t>(1, positions.size());
+        std::cout<<"Epoch "<<epoch + 1<<": loss "<<loss/n<<", top-1 accuracy "<<static_cast<double>(correct)/n<<"\n";
+    }
+
+    return policy.Save(policy_path);
+}
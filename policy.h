@@ -0,0 +1,103 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "pattern.h"
+
+// A linear softmax policy over cheap move features.
+//
+// Every empty point gets two features: its 3x3 pattern
+// seen from the side to move and reduced over the board
+// symmetries, and a context made of tactical flags, the
+// distance to the previous move and the line the point
+// is on. A move's score is the sum of the weights of its
+// two features and the probabilities are the softmax of
+// the scores over all candidates.
+//
+// The policy file is a PolicyFileHeader followed by
+// float pattern_weights[kNumPatterns] and float
+// context_weights[kNumPolicyContexts].
+
+const char kPolicyMagic[4] = {'G','O','P','L'};
+const uint32_t kPolicyVersion = 1;
+
+enum PolicyFlag
+{
+    POLICY_CAPTURE = 1,
+    POLICY_SAVE = 2,
+    POLICY_ATARI = 4,
+    POLICY_SELF_ATARI = 8,
+
+    NUM_POLICY_FLAGS = 16
+};
+
+// 0 if there is no previous move or it was a pass,
+// otherwise the manhattan distance capped at 5.
+const int kPolicyDistances = 6;
+
+// Distance to the closest edge, 0 for the first line.
+const int kPolicyLines = 5;
+
+const int kNumPolicyContexts = NUM_POLICY_FLAGS*kPolicyDistances*kPolicyLines;
+
+#pragma pack(push, 1)
+struct PolicyFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t nr_patterns;
+    uint32_t nr_contexts;
+};
+#pragma pack(pop)
+
+struct PolicyFeatures
+{
+    uint16_t pattern;
+    uint16_t context;
+};
+
+class MovePolicy
+{
+public:
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+
+    // Gets the empty points of the board and their features
+    // for the side to move. Like Board::GenerateMoves, the ko
+    // point, pass-alive areas and the side's own territory
+    // are left out, so no candidates means a pass. Uses the
+    // groups of the latest move.
+    static void GetCandidates(Board *board, std::vector<Coordinate> *moves, std::vector<PolicyFeatures> *features);
+
+    float Score(const PolicyFeatures& features) const
+    {
+        return pattern_weights[features.pattern] + context_weights[features.context];
+    }
+
+    // Fills moves with the candidates ordered from the
+    // most likely to the least likely, and their
+    // probabilities if probabilities is not null.
+    void GenerateMoves(Board *board, std::vector<Coordinate> *moves, std::vector<float> *probabilities = nullptr) const;
+
+    std::vector<float> pattern_weights = std::vector<float>(kNumPatterns);
+    std::vector<float> context_weights = std::vector<float>(kNumPolicyContexts);
+};
+
+struct PolicyTrainingOptions
+{
+    int epochs = 4;
+    float learning_rate = 0.05;
+    int threads = 1;
+};
+
+// Fits the policy to the moves of the games in a record
+// file with stochastic gradient descent on the log loss
+// of the played moves. Returns false if the record file
+// couldn't be read or the policy couldn't be written.
+bool TrainPolicy(const std::string& record_path, const std::string& policy_path, const PolicyTrainingOptions& options);
+
+#endif
@@ -0,0 +1,264 @@
+#include "profiler.h"
+
+#ifdef GO_AI_PROFILE
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace
+{
+    const size_t kRingSize = 4096;
+
+    uint64_t ReadCycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    struct ZoneTotals
+    {
+        uint64_t calls = 0;
+        uint64_t cycles = 0;
+    };
+
+    // The zone names and the totals of all threads
+    // that have exited. Written out when the process ends.
+    class Registry
+    {
+    public:
+        ~Registry() { Dump(); }
+
+        int RegisterZone(const char *name)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            zone_names.push_back(name);
+            return zone_names.size() - 1;
+        }
+
+        std::string ZoneName(int zone)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return zone_names[zone];
+        }
+
+        void Merge(const std::string& path, const ZoneTotals& totals)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ZoneTotals& merged = paths[path];
+            merged.calls += totals.calls;
+            merged.cycles += totals.cycles;
+        }
+
+    private:
+        void Dump()
+        {
+            const char *path = std::getenv("GO_AI_PROFILE_OUT");
+            std::ofstream out((path != nullptr)?path:"profile.folded");
+
+            // Flame graphs want the self time of every stack,
+            // so the time of the child zones is subtracted.
+            std::map<std::string, uint64_t> self_cycles;
+            for(const auto& entry : paths)
+                self_cycles[entry.first] += entry.second.cycles;
+
+            for(const auto& entry : paths)
+            {
+                size_t split = entry.first.rfind(';');
+                if(split == std::string::npos)
+                    continue;
+
+                auto parent = self_cycles.find(entry.first.substr(0, split));
+                if(parent != self_cycles.end())
+                    parent->second -= std::min(parent->second, entry.second.cycles);
+            }
+
+            for(const auto& entry : self_cycles)
+                out<<entry.first<<" "<<entry.second<<"\n";
+
+            // A short per zone summary on stderr.
+            std::map<std::string, ZoneTotals> zones;
+            for(const auto& entry : paths)
+            {
+                size_t split = entry.first.rfind(';');
+                std::string zone = (split == std::string::npos)?entry.first:entry.first.substr(split + 1);
+
+                // Recursive zones are only counted at
+                // the outermost level for the totals.
+                std::string prefix = ";" + entry.first.substr(0, (split == std::string::npos)?0:split) + ";";
+                bool nested_in_itself = prefix.find(";" + zone + ";") != std::string::npos;
+
+                zones[zone].calls += entry.second.calls;
+                if(!nested_in_itself)
+                    zones[zone].cycles += entry.second.cycles;
+            }
+
+            std::cerr<<"Profile zones (calls, cycles, cycles/call):\n";
+            for(const auto& zone : zones)
+            {
+                std::cerr<<"  "<<zone.first<<": "<<zone.second.calls<<", "<<zone.second.cycles;
+                std::cerr<<", "<<((zone.second.calls > 0)?zone.second.cycles/zone.second.calls:0)<<"\n";
+            }
+        }
+
+        std::mutex mutex;
+        std::vector<std::string> zone_names;
+        std::unordered_map<std::string, ZoneTotals> paths;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // The profile of a single thread.
+    //
+    // Every distinct chain of open zones is a node in a
+    // call tree. Finished zones go into a ring buffer as
+    // (node, cycles) and the ring is folded into the node
+    // totals whenever it fills up.
+    class ThreadProfile
+    {
+    public:
+        ThreadProfile()
+        {
+            ring.resize(kRingSize);
+        }
+
+        ~ThreadProfile()
+        {
+            Flush();
+
+            Registry& registry = GetRegistry();
+            for(size_t node = 0; node < nodes.size(); ++node)
+            {
+                if(totals[node].calls > 0)
+                    registry.Merge(Path(node), totals[node]);
+            }
+        }
+
+        void Enter(int zone)
+        {
+            int parent = open_zones.empty()?-1:open_zones.back().node;
+            open_zones.push_back({Child(parent, zone), ReadCycles()});
+        }
+
+        void Leave()
+        {
+            uint64_t end = ReadCycles();
+
+            OpenZone zone = open_zones.back();
+            open_zones.pop_back();
+
+            ring[ring_used++] = {zone.node, end - zone.start};
+            if(ring_used == kRingSize)
+                Flush();
+        }
+
+    private:
+        struct Node
+        {
+            int parent;
+            int zone;
+        };
+
+        struct OpenZone
+        {
+            int node;
+            uint64_t start;
+        };
+
+        struct Sample
+        {
+            int node;
+            uint64_t cycles;
+        };
+
+        int Child(int parent, int zone)
+        {
+            uint64_t key = (static_cast<uint64_t>(parent + 1) << 32) | static_cast<uint32_t>(zone);
+
+            auto found = children.find(key);
+            if(found != children.end())
+                return found->second;
+
+            nodes.push_back({parent, zone});
+            totals.push_back(ZoneTotals());
+
+            int node = nodes.size() - 1;
+            children[key] = node;
+            return node;
+        }
+
+        void Flush()
+        {
+            for(size_t i = 0; i < ring_used; ++i)
+            {
+                ZoneTotals& node_totals = totals[ring[i].node];
+                ++node_totals.calls;
+                node_totals.cycles += ring[i].cycles;
+            }
+            ring_used = 0;
+        }
+
+        std::string Path(int node)
+        {
+            std::string path = GetRegistry().ZoneName(nodes[node].zone);
+            for(int parent = nodes[node].parent; parent != -1; parent = nodes[parent].parent)
+                path = GetRegistry().ZoneName(nodes[parent].zone) + ";" + path;
+
+            return path;
+        }
+
+        std::vector<Node> nodes;
+        std::vector<ZoneTotals> totals;
+        std::unordered_map<uint64_t, int> children;
+
+        std::vector<OpenZone> open_zones;
+
+        std::vector<Sample> ring;
+        size_t ring_used = 0;
+    };
+
+    ThreadProfile& GetThreadProfile()
+    {
+        // Make sure the registry outlives the thread profiles.
+        GetRegistry();
+
+        static thread_local ThreadProfile profile;
+        return profile;
+    }
+}
+
+int Profiler::RegisterZone(const char *name)
+{
+    return GetRegistry().RegisterZone(name);
+}
+
+void Profiler::Enter(int zone)
+{
+    GetThreadProfile().Enter(zone);
+}
+
+void Profiler::Leave()
+{
+    GetThreadProfile().Leave();
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// A scoped zone profiler for the hot paths.
+//
+// Put PROFILE_ZONE("name") at the top of a scope to count
+// the calls and cycles spent in it. Zones nest, so every
+// measurement is stored under the whole chain of open
+// zones. When the process exits the totals are written to
+// a collapsed stack file that flame graph tools read, by
+// default profile.folded or the file in GO_AI_PROFILE_OUT.
+//
+// The zones only exist when compiled with -DGO_AI_PROFILE.
+// Otherwise the macro expands to nothing.
+
+#ifdef GO_AI_PROFILE
+
+namespace Profiler
+{
+    // Returns the id of a zone name. Called once per zone.
+    int RegisterZone(const char *name);
+
+    void Enter(int zone);
+    void Leave();
+};
+
+class ProfileZone
+{
+public:
+    explicit ProfileZone(int zone) { Profiler::Enter(zone); }
+    ~ProfileZone() { Profiler::Leave(); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_ZONE(name) \
+    static const int PROFILE_CONCAT(profile_zone_id_, __LINE__) = Profiler::RegisterZone(name); \
+    ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(PROFILE_CONCAT(profile_zone_id_, __LINE__))
+
+#else
+
+#define PROFILE_ZONE(name)
+
+#endif
+
+#endif
@@ -0,0 +1,317 @@
+#include "record_file.h"
+#include "sgf.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include <unistd.h>
+
+// Flush the write buffer once it grows past this size.
+const size_t kWriteBufferSize = 1 << 20;
+
+static int16_t ToHalfPoints(float value)
+{
+    return static_cast<int16_t>(std::lround(value * 2));
+}
+
+RecordWriter::~RecordWriter()
+{
+    Close();
+}
+
+bool RecordWriter::Open(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    offsets.clear();
+    buffer.clear();
+
+    file = fopen(path.c_str(), "r+b");
+    if(file != nullptr && fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0)
+    {
+        // An empty file is written from scratch.
+        fclose(file);
+        file = nullptr;
+    }
+
+    if(file == nullptr)
+    {
+        file = fopen(path.c_str(), "w+b");
+        if(file == nullptr)
+            return false;
+
+        RecordFileHeader header = {};
+        memcpy(header.magic, kRecordFileMagic, 4);
+        header.version = kRecordFileVersion;
+        header.board_size = kBoardSize;
+
+        if(fwrite(&header, sizeof(header), 1, file) != 1)
+            return false;
+
+        buffer_offset = sizeof(header);
+        return true;
+    }
+
+    // Appending to an existing file. Read its index
+    // and drop it, it is written again on Close().
+    RecordReader reader;
+    if(!reader.Open(path))
+    {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    uint64_t end_of_games = sizeof(RecordFileHeader);
+    GameRecord record;
+    for(uint64_t i = 0; i < reader.NumGames(); ++i)
+    {
+        reader.GetGame(i, &record);
+        offsets.push_back(end_of_games);
+        end_of_games += sizeof(RecordHeader) + record.moves.size();
+    }
+
+    if(ftruncate(fileno(file), end_of_games) != 0 || fseek(file, end_of_games, SEEK_SET) != 0)
+    {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    buffer_offset = end_of_games;
+    return true;
+}
+
+bool RecordWriter::Append(const GameRecord& record)
+{
+    RecordHeader header = {};
+    header.rules = record.rules;
+    header.winner = record.winner;
+    header.resigned = record.resigned;
+    header.komi = ToHalfPoints(record.komi);
+    header.score = ToHalfPoints(record.score);
+    header.nr_moves = record.moves.size();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(file == nullptr)
+        return false;
+
+    offsets.push_back(buffer_offset + buffer.size());
+
+    const char *header_bytes = reinterpret_cast<const char*>(&header);
+    buffer.insert(buffer.end(), header_bytes, header_bytes + sizeof(header));
+
+    for(const Coordinate& move : record.moves)
+        buffer.push_back((move == kPassMove)?kPassCode:move.As1D());
+
+    if(buffer.size() >= kWriteBufferSize)
+        return Flush();
+
+    return true;
+}
+
+bool RecordWriter::Flush()
+{
+    if(buffer.empty())
+        return true;
+
+    bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+
+    buffer_offset += buffer.size();
+    buffer.clear();
+
+    return written;
+}
+
+bool RecordWriter::Close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(file == nullptr)
+        return true;
+
+    bool ok = Flush();
+
+    RecordFileTrailer trailer = {};
+    trailer.index_offset = buffer_offset;
+    trailer.nr_games = offsets.size();
+    memcpy(trailer.magic, kRecordIndexMagic, 4);
+
+    if(!offsets.empty())
+        ok = ok && fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+
+    ok = ok && fwrite(&trailer, sizeof(trailer), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    file = nullptr;
+    return ok;
+}
+
+uint64_t RecordWriter::NumGames()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return offsets.size();
+}
+
+bool RecordReader::Open(const std::string& path)
+{
+    index_data = nullptr;
+    nr_games = 0;
+    scanned_offsets.clear();
+
+    if(!file.Open(path, false))
+        return false;
+
+    RecordFileHeader header;
+    if(file.Size() < sizeof(header))
+        return false;
+
+    memcpy(&header, file.Data(), sizeof(header));
+    if(memcmp(header.magic, kRecordFileMagic, 4) != 0 || header.board_size != kBoardSize)
+        return false;
+
+    RecordFileTrailer trailer;
+    if(file.Size() >= sizeof(header) + sizeof(trailer))
+    {
+        memcpy(&trailer, file.Data() + file.Size() - sizeof(trailer), sizeof(trailer));
+
+        bool valid = memcmp(trailer.magic, kRecordIndexMagic, 4) == 0 &&
+            trailer.index_offset + trailer.nr_games*sizeof(uint64_t) + sizeof(trailer) == file.Size();
+
+        if(valid)
+        {
+            index_data = file.Data() + trailer.index_offset;
+            nr_games = trailer.nr_games;
+            return true;
+        }
+    }
+
+    return ScanGames();
+}
+
+bool RecordReader::ScanGames()
+{
+    uint64_t offset = sizeof(RecordFileHeader);
+    while(offset + sizeof(RecordHeader) <= file.Size())
+    {
+        RecordHeader header;
+        memcpy(&header, file.Data() + offset, sizeof(header));
+
+        uint64_t end = offset + sizeof(header) + header.nr_moves;
+        if(end > file.Size())
+            break;
+
+        scanned_offsets.push_back(offset);
+        offset = end;
+    }
+
+    nr_games = scanned_offsets.size();
+    return true;
+}
+
+uint64_t RecordReader::GameOffset(uint64_t index) const
+{
+    if(index_data == nullptr)
+        return scanned_offsets[index];
+
+    // The index isn't necessarily aligned.
+    uint64_t offset;
+    memcpy(&offset, index_data + index*sizeof(uint64_t), sizeof(offset));
+    return offset;
+}
+
+bool RecordReader::GetGame(uint64_t index, GameRecord *record) const
+{
+    if(index >= nr_games)
+        return false;
+
+    uint64_t offset = GameOffset(index);
+
+    RecordHeader header;
+    if(offset + sizeof(header) > file.Size())
+        return false;
+
+    memcpy(&header, file.Data() + offset, sizeof(header));
+    if(offset + sizeof(header) + header.nr_moves > file.Size())
+        return false;
+
+    record->rules = header.rules;
+    record->winner = header.winner;
+    record->resigned = header.resigned != 0;
+    record->komi = header.komi / 2.0f;
+    record->score = header.score / 2.0f;
+
+    const uint8_t *moves = reinterpret_cast<const uint8_t*>(file.Data() + offset + sizeof(header));
+
+    record->moves.resize(header.nr_moves);
+    for(uint32_t i = 0; i < header.nr_moves; ++i)
+    {
+        if(moves[i] == kPassCode)
+            record->moves[i] = kPassMove;
+        else
+            record->moves[i] = Coordinate::Get2dCoordinate(moves[i]);
+    }
+
+    return true;
+}
+
+int64_t ConvertSgfToRecords(const std::string& sgf_path, const std::string& record_path)
+{
+    SgfReader reader;
+    if(!reader.Open(sgf_path))
+        return -1;
+
+    RecordWriter writer;
+    if(!writer.Open(record_path))
+        return -1;
+
+    int64_t converted = 0;
+    SgfGame game;
+    GameRecord record;
+    while(reader.NextGame(&game))
+    {
+        if(!SgfToRecord(game, &record))
+            continue;
+
+        if(!writer.Append(record))
+            return -1;
+
+        ++converted;
+    }
+
+    if(!writer.Close())
+        return -1;
+
+    return converted;
+}
+
+int64_t ConvertRecordsToSgf(const std::string& record_path, const std::string& sgf_path)
+{
+    RecordReader reader;
+    if(!reader.Open(record_path))
+        return -1;
+
+    std::ofstream out(sgf_path);
+    if(!out)
+        return -1;
+
+    SgfWriter writer(&out);
+
+    GameRecord record;
+    int64_t converted = 0;
+    for(uint64_t i = 0; i < reader.NumGames(); ++i)
+    {
+        if(!reader.GetGame(i, &record))
+            continue;
+
+        writer.Write(record);
+        ++converted;
+    }
+
+    if(!out)
+        return -1;
+
+    return converted;
+}
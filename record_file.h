@@ -0,0 +1,135 @@
+#ifndef RECORD_FILE_H
+#define RECORD_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "game_record.h"
+#include "mapped_file.h"
+
+// A compact binary format for large numbers of games.
+//
+// The file starts with a RecordFileHeader followed by
+// the games back to back. Every game is a RecordHeader
+// followed by one byte per move: the 1d index of the
+// point or kPassCode. The file ends with an index block
+// of 64 bit game offsets and a RecordFileTrailer that
+// points to it, which gives O(1) access to any game.
+//
+// All numbers are stored in native byte order, which
+// is little endian on the supported hosts.
+
+const char kRecordFileMagic[4] = {'G','O','R','F'};
+const char kRecordIndexMagic[4] = {'G','O','R','I'};
+const uint16_t kRecordFileVersion = 1;
+const uint8_t kPassCode = 255;
+
+#pragma pack(push, 1)
+struct RecordFileHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint8_t board_size;
+    uint8_t reserved[9];
+};
+
+struct RecordHeader
+{
+    uint8_t rules;
+    uint8_t winner;
+    uint8_t resigned;
+    uint8_t reserved;
+
+    // Komi and score are stored in half points.
+    int16_t komi;
+    int16_t score;
+
+    uint32_t nr_moves;
+};
+
+struct RecordFileTrailer
+{
+    uint64_t index_offset;
+    uint64_t nr_games;
+    char magic[4];
+    uint32_t reserved;
+};
+#pragma pack(pop)
+
+// Appends games to a record file.
+//
+// Appending is thread safe so that many self play
+// threads can share a single writer. The games are
+// buffered and the index is written on Close().
+class RecordWriter
+{
+public:
+    RecordWriter() {}
+    ~RecordWriter();
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    // Opens the file for appending. A new file is
+    // created if it doesn't exist. Returns false if the
+    // file couldn't be opened or isn't a record file.
+    bool Open(const std::string& path);
+
+    bool Append(const GameRecord& record);
+
+    // Writes out the buffered games and the index.
+    bool Close();
+
+    uint64_t NumGames();
+
+private:
+    bool Flush();
+
+    std::mutex mutex;
+    FILE *file = nullptr;
+
+    std::vector<char> buffer;
+    std::vector<uint64_t> offsets;
+
+    // File offset of the first byte in the buffer.
+    uint64_t buffer_offset = 0;
+};
+
+// Reads a memory mapped record file.
+class RecordReader
+{
+public:
+    // Maps the file. If the file has no valid index,
+    // for example because the writer was killed, the
+    // index is rebuilt by scanning the games.
+    bool Open(const std::string& path);
+
+    uint64_t NumGames() const { return nr_games; }
+
+    // Decodes the game with the given index.
+    bool GetGame(uint64_t index, GameRecord *record) const;
+
+private:
+    bool ScanGames();
+    uint64_t GameOffset(uint64_t index) const;
+
+    MappedFile file;
+
+    // The index block inside the mapping. It is null
+    // if the index had to be rebuilt into scanned_offsets.
+    const char *index_data = nullptr;
+    uint64_t nr_games = 0;
+
+    std::vector<uint64_t> scanned_offsets;
+};
+
+// Converters between SGF collections and record files.
+// Games that can't be converted are skipped.
+// Returns the number of converted games or -1 on failure.
+int64_t ConvertSgfToRecords(const std::string& sgf_path, const std::string& record_path);
+int64_t ConvertRecordsToSgf(const std::string& record_path, const std::string& sgf_path);
+
+#endif
@@ -0,0 +1,277 @@
+#include "reference_board.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+bool ReferenceBoard::MakeMove(const Coordinate& c)
+{
+    if(c.x < 0 || c.x >= kBoardSize || c.y < 0 || c.y >= kBoardSize)
+        return false;
+
+    if(Occupied(c))
+        return false;
+
+    Move current_move;
+    current_move.point = c;
+    current_move.ko_active = ko_active;
+    current_move.ko_point = ko_point;
+    current_move.white_passed = white_passed;
+    current_move.black_passed = black_passed;
+
+    if(ko_active && ko_point == c)
+        return false;
+
+    ko_active = false;
+    ko_point = {-1,-1};
+
+    board_array[c.x][c.y] = side_to_play;
+
+    if(!CheckForCaptures(&current_move))
+    {
+        board_array[c.x][c.y] = EMPTY;
+        ko_active = current_move.ko_active;
+        ko_point = current_move.ko_point;
+        return false;
+    }
+
+    if(side_to_play == BLACK)
+    {
+        black_passed = false;
+        side_to_play = WHITE;
+    }
+    else
+    {
+        white_passed = false;
+        side_to_play = BLACK;
+    }
+
+    played_moves.push_back(current_move);
+    return true;
+}
+
+void ReferenceBoard::UndoLastMove()
+{
+    if(played_moves.empty())
+        return;
+
+    Move& played_move = played_moves.back();
+
+    white_passed = played_move.white_passed;
+    black_passed = played_move.black_passed;
+    ko_active = played_move.ko_active;
+    ko_point = played_move.ko_point;
+
+    if(played_move.point == kPassMove)
+    {
+        side_to_play = OppositeSide(side_to_play);
+        played_moves.pop_back();
+        return;
+    }
+
+    board_array[played_move.point.x][played_move.point.y] = EMPTY;
+
+    for(const Group& group : played_move.captured_groups)
+    {
+        for(const Coordinate& stone : group.stones)
+            board_array[stone.x][stone.y] = side_to_play;
+    }
+
+    if(side_to_play == WHITE)
+    {
+        side_to_play = BLACK;
+        captures_black -= played_move.nr_captured_stones;
+    }
+    else
+    {
+        side_to_play = WHITE;
+        captures_white -= played_move.nr_captured_stones;
+    }
+
+    played_moves.pop_back();
+}
+
+void ReferenceBoard::Pass()
+{
+    Move current_move;
+    current_move.point = kPassMove;
+    current_move.ko_active = ko_active;
+    current_move.ko_point = ko_point;
+    current_move.white_passed = white_passed;
+    current_move.black_passed = black_passed;
+
+    ko_active = false;
+    ko_point = {-1,-1};
+
+    if(side_to_play == WHITE)
+        white_passed = true;
+    else
+        black_passed = true;
+
+    side_to_play = OppositeSide(side_to_play);
+    played_moves.push_back(current_move);
+}
+
+bool ReferenceBoard::CheckForCaptures(Move *current_move)
+{
+    white_groups.clear();
+    black_groups.clear();
+
+    bool possible_suicide = false;
+
+    // Flood fill every group and remove the
+    // ones that have no liberties left.
+    std::unordered_set<int> checked;
+    for(int x = 0; x < kBoardSize; ++x)
+    {
+        for(int y = 0; y < kBoardSize; ++y)
+        {
+            Coordinate start = {x,y};
+            if(checked.count(start.As1D()) > 0)
+                continue;
+
+            checked.insert(start.As1D());
+
+            int color = board_array[x][y];
+            if(color == EMPTY)
+                continue;
+
+            std::vector<Coordinate> stack = {start};
+            std::vector<Coordinate> stones = {start};
+            std::vector<Coordinate> liberties;
+
+            while(!stack.empty())
+            {
+                Coordinate c = stack.back();
+                stack.pop_back();
+
+                const Coordinate neighbors[4] = {{c.x-1,c.y},{c.x+1,c.y},{c.x,c.y-1},{c.x,c.y+1}};
+                for(const Coordinate& n : neighbors)
+                {
+                    if(n.x < 0 || n.x >= kBoardSize || n.y < 0 || n.y >= kBoardSize)
+                        continue;
+
+                    int value = board_array[n.x][n.y];
+                    if(value == EMPTY)
+                    {
+                        if(std::find(liberties.begin(), liberties.end(), n) == liberties.end())
+                            liberties.push_back(n);
+                    }
+                    else if(value == color && checked.count(n.As1D()) == 0)
+                    {
+                        checked.insert(n.As1D());
+                        stack.push_back(n);
+                        stones.push_back(n);
+                    }
+                }
+            }
+
+            if(liberties.empty())
+            {
+                if(color == side_to_play)
+                {
+                    possible_suicide = true;
+                    continue;
+                }
+
+                if(side_to_play == WHITE)
+                    captures_white += stones.size();
+                else
+                    captures_black += stones.size();
+
+                if(stones.size() == 1)
+                {
+                    ko_active = true;
+                    ko_point = stones[0];
+                }
+
+                Group captured;
+                captured.stones = stones;
+                current_move->captured_groups.push_back(captured);
+                current_move->nr_captured_stones += stones.size();
+
+                for(const Coordinate& stone : stones)
+                    board_array[stone.x][stone.y] = EMPTY;
+
+                possible_suicide = false;
+            }
+            else
+            {
+                Group group;
+                group.stones = stones;
+                group.liberties = liberties;
+
+                if(color == WHITE)
+                    white_groups.push_back(group);
+                else
+                    black_groups.push_back(group);
+            }
+        }
+    }
+
+    return !possible_suicide;
+}
+
+void ReferenceBoard::CalculateScore()
+{
+    territory_white = 0;
+    territory_black = 0;
+    for(auto& column : territory_array)
+        column.fill(COLOR_NONE);
+
+    // Flood fill the empty regions. A region that only
+    // touches stones of one color is that color's territory.
+    std::unordered_set<int> checked;
+    for(int y = 0; y < kBoardSize; ++y)
+    {
+        for(int x = 0; x < kBoardSize; ++x)
+        {
+            Coordinate start = {x,y};
+            if(board_array[x][y] != EMPTY || checked.count(start.As1D()) > 0)
+                continue;
+
+            checked.insert(start.As1D());
+
+            std::vector<Coordinate> stack = {start};
+            std::vector<Coordinate> region = {start};
+            bool touches_black = false;
+            bool touches_white = false;
+
+            while(!stack.empty())
+            {
+                Coordinate c = stack.back();
+                stack.pop_back();
+
+                const Coordinate neighbors[4] = {{c.x-1,c.y},{c.x+1,c.y},{c.x,c.y-1},{c.x,c.y+1}};
+                for(const Coordinate& n : neighbors)
+                {
+                    if(n.x < 0 || n.x >= kBoardSize || n.y < 0 || n.y >= kBoardSize)
+                        continue;
+
+                    int value = board_array[n.x][n.y];
+                    if(value == BLACK)
+                        touches_black = true;
+                    else if(value == WHITE)
+                        touches_white = true;
+                    else if(checked.count(n.As1D()) == 0)
+                    {
+                        checked.insert(n.As1D());
+                        stack.push_back(n);
+                        region.push_back(n);
+                    }
+                }
+            }
+
+            if(touches_black == touches_white)
+                continue;
+
+            int owner = touches_black?BLACK:WHITE;
+            if(owner == WHITE)
+                territory_white += region.size();
+            else
+                territory_black += region.size();
+
+            for(const Coordinate& c : region)
+                territory_array[c.x][c.y] = owner;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef REFERENCE_BOARD_H
+#define REFERENCE_BOARD_H
+
+#include <array>
+#include <vector>
+
+#include "board.h"
+
+// The original flood fill implementation of the board
+// rules, kept as an oracle for the optimized Board.
+//
+// Only the rules are kept: making and undoing moves,
+// captures, ko, suicide, passes and territory. Don't
+// optimize this class, its whole point is to stay simple
+// enough to be obviously right.
+class ReferenceBoard
+{
+public:
+    ReferenceBoard() {}
+
+    bool Occupied(const Coordinate& c) const { return board_array[c.x][c.y] != EMPTY; }
+
+    // Same rules and return values as Board::MakeMove.
+    bool MakeMove(const Coordinate& c);
+    void UndoLastMove();
+    void Pass();
+
+    // Territory by flood fill only. The rules make no
+    // difference to it, so there is no rules argument.
+    void CalculateScore();
+
+    int GetStone(int x, int y) const { return board_array[x][y]; }
+    int GetTerritory(int x, int y) const { return territory_array[x][y]; }
+    int GetTerritoryCount(int side) const { return (side == WHITE)?territory_white:territory_black; }
+    int GetCaptures(int side) const { return (side == WHITE)?captures_white:captures_black; }
+    int GetSideToMove() const { return side_to_play; }
+    const std::vector<Group>& GetGroups(int side) const { return (side == WHITE)?white_groups:black_groups; }
+
+private:
+    bool CheckForCaptures(Move *current_move);
+    int OppositeSide(int side) const { return (side == BLACK)?WHITE:BLACK; }
+
+    std::vector<Move> played_moves;
+
+    bool white_passed = false;
+    bool black_passed = false;
+
+    int captures_white = 0;
+    int captures_black = 0;
+
+    int territory_white = 0;
+    int territory_black = 0;
+
+    bool ko_active = false;
+    Coordinate ko_point = {-1,-1};
+
+    int side_to_play = BLACK;
+
+    std::vector<Group> white_groups;
+    std::vector<Group> black_groups;
+
+    std::array<std::array<int,kBoardSize>,kBoardSize> board_array = {{EMPTY}};
+    std::array<std::array<int,kBoardSize>,kBoardSize> territory_array = {{EMPTY}};
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "search_stats.h"
+
+#include <sstream>
+
+void SearchStats::Add(const SearchStats& other)
+{
+    nodes += other.nodes;
+    leaf_evaluations += other.leaf_evaluations;
+    interior_nodes += other.interior_nodes;
+    children_searched += other.children_searched;
+
+    cutoffs += other.cutoffs;
+    for(int i = 0; i < kMaxCutoffIndex; ++i)
+        cutoffs_by_index[i] += other.cutoffs_by_index[i];
+
+    generate_moves_ns += other.generate_moves_ns;
+    make_move_ns += other.make_move_ns;
+    evaluate_ns += other.evaluate_ns;
+}
+
+void SearchStats::RecordCutoff(int move_index)
+{
+    ++cutoffs;
+
+    if(move_index >= kMaxCutoffIndex)
+        move_index = kMaxCutoffIndex - 1;
+
+    ++cutoffs_by_index[move_index];
+}
+
+double SearchStats::EffectiveBranchingFactor() const
+{
+    if(interior_nodes == 0)
+        return 0;
+
+    return static_cast<double>(children_searched) / interior_nodes;
+}
+
+std::string SearchStats::ToText() const
+{
+    std::ostringstream out;
+
+    out<<"Nodes: "<<nodes<<" ("<<((seconds > 0)?nodes/seconds:0)<<" nodes/s)\n";
+    out<<"Leaf evaluations: "<<leaf_evaluations<<"\n";
+    out<<"Effective branching factor: "<<EffectiveBranchingFactor()<<"\n";
+
+    out<<"Cutoffs: "<<cutoffs;
+    if(cutoffs > 0)
+    {
+        // Good move ordering puts most cutoffs on the first move.
+        out<<" ("<<100.0*cutoffs_by_index[0]/cutoffs<<"% on the first move)";
+    }
+    out<<"\n";
+
+    out<<"Time: "<<seconds*1000<<" ms, GenerateMoves "<<generate_moves_ns/1e6<<" ms";
+    out<<", MakeMove "<<make_move_ns/1e6<<" ms";
+    out<<", Evaluate "<<evaluate_ns/1e6<<" ms\n";
+
+    return out.str();
+}
+
+std::string SearchStats::ToJson() const
+{
+    std::ostringstream out;
+
+    out<<"{\"depth\": "<<depth;
+    out<<", \"seconds\": "<<seconds;
+    out<<", \"nodes\": "<<nodes;
+    out<<", \"nodes_per_sec\": "<<((seconds > 0)?nodes/seconds:0);
+    out<<", \"leaf_evaluations\": "<<leaf_evaluations;
+    out<<", \"effective_branching_factor\": "<<EffectiveBranchingFactor();
+    out<<", \"cutoffs\": "<<cutoffs;
+
+    out<<", \"cutoffs_by_index\": [";
+    for(int i = 0; i < kMaxCutoffIndex; ++i)
+        out<<((i > 0)?", ":"")<<cutoffs_by_index[i];
+    out<<"]";
+
+    out<<", \"generate_moves_ns\": "<<generate_moves_ns;
+    out<<", \"make_move_ns\": "<<make_move_ns;
+    out<<", \"evaluate_ns\": "<<evaluate_ns<<"}";
+
+    return out.str();
+}
@@ -0,0 +1,69 @@
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Beta cutoffs are counted per move index up to
+// this index. Later cutoffs share the last bucket.
+const int kMaxCutoffIndex = 16;
+
+// Counters for a single search.
+struct SearchStats
+{
+    uint64_t nodes = 0;
+    uint64_t leaf_evaluations = 0;
+
+    // Interior nodes that searched at least one child
+    // and the number of children they searched.
+    uint64_t interior_nodes = 0;
+    uint64_t children_searched = 0;
+
+    uint64_t cutoffs = 0;
+    uint64_t cutoffs_by_index[kMaxCutoffIndex] = {0};
+
+    // Time spent in the board functions in nanoseconds.
+    uint64_t generate_moves_ns = 0;
+    uint64_t make_move_ns = 0;
+    uint64_t evaluate_ns = 0;
+
+    // Set once the search is done.
+    int depth = 0;
+    double seconds = 0;
+
+    void Reset() { *this = SearchStats(); }
+    void Add(const SearchStats& other);
+
+    void RecordCutoff(int move_index);
+
+    // Average number of children searched per interior node.
+    double EffectiveBranchingFactor() const;
+
+    // Multi line summary for people.
+    std::string ToText() const;
+
+    // Single line JSON object.
+    std::string ToJson() const;
+};
+
+// Adds the time from construction to destruction
+// to a nanosecond counter.
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(uint64_t *counter)
+        : counter(counter), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        *counter += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+private:
+    uint64_t *counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "search_trace.h"
+#include "board.h"
+#include "mapped_file.h"
+
+#include <cstring>
+#include <fstream>
+
+SearchTraceWriter::~SearchTraceWriter()
+{
+    Close();
+}
+
+bool SearchTraceWriter::Open(const std::string& path)
+{
+    Close();
+
+    file = fopen(path.c_str(), "wb");
+    if(file == nullptr)
+        return false;
+
+    stopping = false;
+    failed = false;
+    has_work = false;
+
+    filling.reserve(kTraceBufferRecords);
+    writer = std::thread(&SearchTraceWriter::WriterLoop, this);
+
+    return true;
+}
+
+void SearchTraceWriter::HandOff()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Wait for the writer to finish the previous buffer.
+    changed.wait(lock, [this]() { return !has_work; });
+
+    writing.swap(filling);
+    filling.clear();
+    has_work = true;
+
+    changed.notify_all();
+}
+
+void SearchTraceWriter::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while(true)
+    {
+        changed.wait(lock, [this]() { return has_work || stopping; });
+
+        if(has_work)
+        {
+            // The search can't touch this buffer until
+            // has_work is cleared, so write it unlocked.
+            lock.unlock();
+            bool written = fwrite(writing.data(), sizeof(TraceRecord), writing.size(), file) == writing.size();
+            lock.lock();
+
+            failed = failed || !written;
+            has_work = false;
+            changed.notify_all();
+            continue;
+        }
+
+        if(stopping)
+            return;
+    }
+}
+
+bool SearchTraceWriter::Close()
+{
+    if(file == nullptr)
+        return true;
+
+    if(!filling.empty())
+        HandOff();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+
+    bool ok = !failed;
+    ok = (fclose(file) == 0) && ok;
+    file = nullptr;
+
+    return ok;
+}
+
+namespace
+{
+    struct TraceNode
+    {
+        TraceRecord record;
+        std::vector<size_t> children;
+    };
+
+    // Rebuilds the search trees from the records.
+    // Returns the indices of the root nodes.
+    bool ReadTrace(const std::string& path, size_t max_nodes, std::vector<TraceNode> *nodes, std::vector<size_t> *roots)
+    {
+        MappedFile file;
+        if(!file.Open(path))
+            return false;
+
+        size_t nr_records = file.Size() / sizeof(TraceRecord);
+        if(nr_records > max_nodes)
+            nr_records = max_nodes;
+
+        // Children wait in pending[ply] until
+        // their parent at ply-1 shows up.
+        std::vector<std::vector<size_t>> pending;
+
+        for(size_t i = 0; i < nr_records; ++i)
+        {
+            TraceNode node;
+            memcpy(&node.record, file.Data() + i*sizeof(TraceRecord), sizeof(TraceRecord));
+
+            size_t ply = node.record.ply;
+            if(pending.size() < ply + 2)
+                pending.resize(ply + 2);
+
+            node.children.swap(pending[ply + 1]);
+            nodes->push_back(node);
+
+            if(ply == 0)
+                roots->push_back(nodes->size() - 1);
+            else
+                pending[ply].push_back(nodes->size() - 1);
+        }
+
+        return true;
+    }
+
+    std::string MoveName(uint8_t move)
+    {
+        if(move == kTraceNoMove)
+            return "root";
+        if(move == kTracePass)
+            return "pass";
+
+        Coordinate c = Coordinate::Get2dCoordinate(move);
+        return "(" + std::to_string(c.x) + "," + std::to_string(c.y) + ")";
+    }
+
+    void WriteJsonNode(std::ostream& out, const std::vector<TraceNode>& nodes, size_t index)
+    {
+        const TraceNode& node = nodes[index];
+        const TraceRecord& r = node.record;
+
+        out<<"{\"ply\": "<<static_cast<int>(r.ply);
+        out<<", \"move\": \""<<MoveName(r.move)<<"\"";
+        out<<", \"side\": "<<static_cast<int>(r.side_to_move);
+        out<<", \"alpha\": "<<r.alpha<<", \"beta\": "<<r.beta<<", \"score\": "<<r.score;
+        out<<", \"leaf\": "<<((r.flags & TRACE_LEAF)?"true":"false");
+        out<<", \"cutoff\": "<<((r.flags & TRACE_CUTOFF)?"true":"false");
+        out<<", \"out_of_time\": "<<((r.flags & TRACE_OUT_OF_TIME)?"true":"false");
+
+        if(!node.children.empty())
+        {
+            out<<", \"children\": [";
+            for(size_t i = 0; i < node.children.size(); ++i)
+            {
+                if(i > 0)
+                    out<<", ";
+                WriteJsonNode(out, nodes, node.children[i]);
+            }
+            out<<"]";
+        }
+
+        out<<"}";
+    }
+}
+
+bool TraceToDot(const std::string& trace_path, const std::string& output_path, size_t max_nodes)
+{
+    std::vector<TraceNode> nodes;
+    std::vector<size_t> roots;
+    if(!ReadTrace(trace_path, max_nodes, &nodes, &roots))
+        return false;
+
+    std::ofstream out(output_path);
+    out<<"digraph search {\n";
+    out<<"    node [shape=box, fontsize=10];\n";
+
+    for(size_t i = 0; i < nodes.size(); ++i)
+    {
+        const TraceRecord& r = nodes[i].record;
+
+        out<<"    n"<<i<<" [label=\""<<MoveName(r.move)<<"\\n"<<r.score;
+        out<<"\\n["<<r.alpha<<", "<<r.beta<<"]\"";
+        if(r.flags & TRACE_CUTOFF)
+            out<<", color=red";
+        else if(r.flags & TRACE_LEAF)
+            out<<", style=dashed";
+        out<<"];\n";
+
+        for(size_t child : nodes[i].children)
+            out<<"    n"<<i<<" -> n"<<child<<";\n";
+    }
+
+    out<<"}\n";
+    return static_cast<bool>(out);
+}
+
+bool TraceToJson(const std::string& trace_path, const std::string& output_path, size_t max_nodes)
+{
+    std::vector<TraceNode> nodes;
+    std::vector<size_t> roots;
+    if(!ReadTrace(trace_path, max_nodes, &nodes, &roots))
+        return false;
+
+    std::ofstream out(output_path);
+    out<<"[\n";
+    for(size_t i = 0; i < roots.size(); ++i)
+    {
+        WriteJsonNode(out, nodes, roots[i]);
+        out<<((i + 1 < roots.size())?",\n":"\n");
+    }
+    out<<"]\n";
+
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,100 @@
+#ifndef SEARCH_TRACE_H
+#define SEARCH_TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Search traces record every node the search visits.
+//
+// A node is written when the search leaves it, so the
+// children of a node always come right before it. The
+// root of each search has ply 0 and no move. A trace
+// file is just the TraceRecord structs back to back.
+
+const uint8_t kTraceNoMove = 254;
+const uint8_t kTracePass = 255;
+
+enum TraceFlags
+{
+    TRACE_LEAF = 1,
+    TRACE_CUTOFF = 2,
+    TRACE_OUT_OF_TIME = 4
+};
+
+#pragma pack(push, 1)
+struct TraceRecord
+{
+    uint8_t ply;
+
+    // 1d point of the move that led to the node.
+    uint8_t move;
+    uint8_t flags;
+    uint8_t side_to_move;
+
+    // The window the node was searched with and its value.
+    float alpha;
+    float beta;
+    float score;
+};
+#pragma pack(pop)
+
+// Writes trace records to a file on a background thread.
+//
+// The search fills one buffer while the writer thread
+// writes out the other one, so the search only stops
+// when the disk can't keep up. A writer is meant to be
+// used by a single search thread at a time.
+class SearchTraceWriter
+{
+public:
+    SearchTraceWriter() {}
+    ~SearchTraceWriter();
+
+    SearchTraceWriter(const SearchTraceWriter&) = delete;
+    SearchTraceWriter& operator=(const SearchTraceWriter&) = delete;
+
+    bool Open(const std::string& path);
+
+    // Writes out everything and stops the writer thread.
+    bool Close();
+
+    void Add(const TraceRecord& record)
+    {
+        filling.push_back(record);
+        if(filling.size() == kTraceBufferRecords)
+            HandOff();
+    }
+
+private:
+    static const size_t kTraceBufferRecords = 1 << 16;
+
+    void HandOff();
+    void WriterLoop();
+
+    FILE *file = nullptr;
+
+    std::vector<TraceRecord> filling;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<TraceRecord> writing;
+    bool has_work = false;
+    bool stopping = false;
+    bool failed = false;
+
+    std::thread writer;
+};
+
+// Converts a trace file to Graphviz DOT or JSON. Only
+// the first max_nodes nodes are converted, the full
+// trees of a search quickly get too big to look at.
+// Returns false if the files couldn't be read or written.
+bool TraceToDot(const std::string& trace_path, const std::string& output_path, size_t max_nodes);
+bool TraceToJson(const std::string& trace_path, const std::string& output_path, size_t max_nodes);
+
+#endif
@@ -0,0 +1,147 @@
+#include "self_play.h"
+#include "ai.h"
+#include "ownership.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <future>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Picks one of the first few generated moves.
+    // Passes if none of them can be played.
+    void PlayRandomOpeningMove(Board *board, std::mt19937 *rng)
+    {
+        const int kCandidates = 8;
+
+        std::vector<Coordinate> moves;
+        board->GenerateMoves(&moves, board->GetSideToMove());
+        if(moves.size() > kCandidates)
+            moves.resize(kCandidates);
+
+        while(!moves.empty())
+        {
+            size_t i = (*rng)() % moves.size();
+            if(board->MakeMove(moves[i]))
+                return;
+
+            moves.erase(moves.begin() + i);
+        }
+
+        board->Pass();
+    }
+}
+
+float ScoreGame(Board *board)
+{
+    // Games run on threads of their own,
+    // so the playouts stay on this one.
+    std::vector<Coordinate> dead;
+    FindDeadStones(*board, OwnershipOptions(), &dead);
+    board->RemoveDeadStones(dead);
+
+    board->CalculateScore(JAPANESE_RULES);
+
+    float black_score = board->GetTerritoryCount(BLACK) + board->GetCaptures(BLACK);
+    float white_score = board->GetTerritoryCount(WHITE) + board->GetCaptures(WHITE) + kKomi;
+
+    return black_score - white_score;
+}
+
+int PlaySelfPlayGame(const Parameters& black, const Parameters& white, uint32_t seed, const SelfPlayOptions& options, GameRecord *record, std::array<uint64_t,NUM_COLORS> *nodes)
+{
+    std::mt19937 rng(seed);
+
+    Board board;
+    for(int i = 0; i < options.opening_moves; ++i)
+        PlayRandomOpeningMove(&board, &rng);
+
+    Ai black_ai;
+    black_ai.SetParameters(black);
+
+    Ai white_ai;
+    white_ai.SetParameters(white);
+
+    for(Ai *ai : {&black_ai, &white_ai})
+    {
+        ai->SetVerbose(false);
+        ai->SetTimeBudget(options.time_budget_ms);
+    }
+
+    if(nodes != nullptr)
+        nodes->fill(0);
+
+    while(!board.EndGame() && board.GetMovesPlayed() < options.max_moves)
+    {
+        int side = board.GetSideToMove();
+        Ai *ai = (side == BLACK)?&black_ai:&white_ai;
+        if(!ai->PlayMove(&board))
+            board.Pass();
+
+        if(nodes != nullptr)
+            (*nodes)[side] += ai->GetNodesSearched();
+    }
+
+    float margin = ScoreGame(&board);
+    int winner = (margin > 0)?BLACK:WHITE;
+
+    if(record != nullptr)
+    {
+        RecordFromBoard(board, record);
+        record->winner = winner;
+        record->score = (margin > 0)?margin:-margin;
+        record->resigned = false;
+    }
+
+    return winner;
+}
+
+MatchResult PlayMatch(const Parameters& first, const Parameters& second, int pairs, int threads, uint32_t seed, const SelfPlayOptions& options)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    ThreadPool pool(threads, pairs*2);
+    std::mt19937 rng(seed);
+
+    struct GameResult
+    {
+        int winner;
+        std::array<uint64_t,NUM_COLORS> nodes;
+    };
+
+    auto play = [&options](const Parameters& black, const Parameters& white, uint32_t game_seed)
+    {
+        GameResult result;
+        result.winner = PlaySelfPlayGame(black, white, game_seed, options, nullptr, &result.nodes);
+        return result;
+    };
+
+    std::vector<std::future<GameResult>> first_as_black;
+    std::vector<std::future<GameResult>> first_as_white;
+    for(int game = 0; game < pairs; ++game)
+    {
+        uint32_t game_seed = rng();
+        first_as_black.push_back(pool.Submit([=]() { return play(first, second, game_seed); }));
+        first_as_white.push_back(pool.Submit([=]() { return play(second, first, game_seed); }));
+    }
+
+    MatchResult match;
+    for(int first_color : {BLACK, WHITE})
+    {
+        int second_color = (first_color == BLACK)?WHITE:BLACK;
+        for(auto& future : (first_color == BLACK)?first_as_black:first_as_white)
+        {
+            GameResult result = future.get();
+
+            ++match.games;
+            match.wins += (result.winner == first_color)?1:0;
+            match.nodes += result.nodes[first_color];
+            match.opponent_nodes += result.nodes[second_color];
+        }
+    }
+
+    match.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return match;
+}
@@ -0,0 +1,60 @@
+#ifndef SELF_PLAY_H
+#define SELF_PLAY_H
+
+#include <array>
+#include <cstdint>
+
+#include "board.h"
+#include "game_record.h"
+#include "parameters.h"
+
+struct SelfPlayOptions
+{
+    // Moves picked at random from the generated
+    // moves before the ais take over, so that games
+    // with the same parameters don't all repeat.
+    int opening_moves = 6;
+
+    // Games that reach this many moves are scored
+    // as they stand.
+    int max_moves = 150;
+
+    // Time budget per move in milliseconds,
+    // 0 searches to the full depth.
+    int time_budget_ms = 0;
+};
+
+// Plays a game between two ais with the given
+// parameters and returns the winner, BLACK or WHITE.
+// The opening is drawn from the seed, so two games
+// with the same seed start from the same position.
+// The record is filled in if one is given, and the
+// nodes searched by each side, indexed by color, if
+// nodes is given.
+int PlaySelfPlayGame(const Parameters& black, const Parameters& white, uint32_t seed, const SelfPlayOptions& options, GameRecord *record = nullptr, std::array<uint64_t,NUM_COLORS> *nodes = nullptr);
+
+struct MatchResult
+{
+    int games = 0;
+
+    // Games won by the first parameters.
+    int wins = 0;
+
+    // Nodes searched by each side over all the games.
+    uint64_t nodes = 0;
+    uint64_t opponent_nodes = 0;
+
+    double seconds = 0;
+};
+
+// Plays games between two sets of parameters in parallel.
+// Each of the pairs openings is played twice, once with
+// each side as black.
+MatchResult PlayMatch(const Parameters& first, const Parameters& second, int pairs, int threads, uint32_t seed, const SelfPlayOptions& options);
+
+// Removes the dead stones, see ownership.h, and scores
+// the game with Japanese rules and komi. A positive
+// margin is a black win.
+float ScoreGame(Board *board);
+
+#endif
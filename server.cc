@@ -0,0 +1,399 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+ServerStats::ServerStats()
+{
+    start_time = std::chrono::steady_clock::now();
+    latencies.reserve(kLatencySamples);
+    search_times.reserve(kLatencySamples);
+}
+
+void ServerStats::RecordGenmove(double latency_ms, double search_ms)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ++genmoves;
+
+    if(latencies.size() < kLatencySamples)
+    {
+        latencies.push_back(latency_ms);
+        search_times.push_back(search_ms);
+    }
+    else
+    {
+        latencies[next_sample] = latency_ms;
+        search_times[next_sample] = search_ms;
+    }
+
+    next_sample = (next_sample + 1) % kLatencySamples;
+}
+
+std::string ServerStats::Summary()
+{
+    std::vector<double> latency_samples;
+    std::vector<double> search_samples;
+    uint64_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latency_samples = latencies;
+        search_samples = search_times;
+        total = genmoves;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    auto percentile = [](std::vector<double>& samples, double p) -> double
+    {
+        if(samples.empty())
+            return 0;
+
+        size_t index = static_cast<size_t>(p * (samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    };
+
+    std::ostringstream out;
+    out<<"genmoves="<<total;
+    out<<" genmoves_per_sec="<<((seconds > 0)?total/seconds:0);
+    out<<" p50_ms="<<percentile(latency_samples, 0.50);
+    out<<" p99_ms="<<percentile(latency_samples, 0.99);
+    out<<" search_p50_ms="<<percentile(search_samples, 0.50);
+    out<<" search_p99_ms="<<percentile(search_samples, 0.99);
+
+    return out.str();
+}
+
+GameServer::GameServer(int nr_threads, int max_queued_searches)
+    : search_pool(nr_threads, max_queued_searches)
+{}
+
+GameServer::~GameServer()
+{
+    // The client threads use the games and the
+    // pool, they have to end before those do.
+    StopClients();
+}
+
+std::shared_ptr<GameEntry> GameServer::FindGame(int id)
+{
+    std::lock_guard<std::mutex> lock(games_mutex);
+
+    auto found = games.find(id);
+    if(found == games.end())
+        return nullptr;
+
+    return found->second;
+}
+
+std::string GameServer::NewGame()
+{
+    auto game = std::make_shared<GameEntry>();
+    game->ai.SetVerbose(false);
+    game->ai.SetTimeBudget(game->time_budget_ms);
+
+    std::lock_guard<std::mutex> lock(games_mutex);
+    game->ai.SetParameters(parameters);
+    int id = ++next_game_id;
+    games[id] = game;
+
+    return "= " + std::to_string(id);
+}
+
+std::string GameServer::PlayMove(int id, std::istringstream& args)
+{
+    std::shared_ptr<GameEntry> game = FindGame(id);
+    if(!game)
+        return "? unknown game";
+
+    std::string first;
+    args>>first;
+
+    std::lock_guard<std::mutex> lock(game->mutex);
+
+    if(first == "pass")
+    {
+        game->board.Pass();
+        return "=";
+    }
+
+    int x, y;
+    std::istringstream x_stream(first);
+    if(!(x_stream>>x) || !(args>>y))
+        return "? expected coordinates";
+
+    if(x < 0 || x >= kBoardSize || y < 0 || y >= kBoardSize)
+        return "? coordinates out of range";
+
+    if(game->board.Occupied({x,y}))
+        return "? point is occupied";
+
+    if(!game->board.MakeMove({x,y}))
+        return "? illegal move";
+
+    return "=";
+}
+
+std::string GameServer::GenerateMove(int id)
+{
+    std::shared_ptr<GameEntry> game = FindGame(id);
+    if(!game)
+        return "? unknown game";
+
+    // The search runs on the pool. The connection
+    // thread just waits for the result, so a slow
+    // search never blocks other clients.
+    auto submitted = std::chrono::steady_clock::now();
+    double search_ms = 0;
+
+    std::future<std::string> reply = search_pool.Submit([game, &search_ms]()
+    {
+        std::lock_guard<std::mutex> lock(game->mutex);
+
+        auto start = std::chrono::steady_clock::now();
+
+        Coordinate best_move;
+        bool got_move = game->ai.GetBestMove(&game->board, &best_move);
+
+        std::string result;
+        if(got_move && game->board.MakeMove(best_move))
+        {
+            result = "= " + std::to_string(best_move.x) + " " + std::to_string(best_move.y);
+        }
+        else
+        {
+            game->board.Pass();
+            result = "= pass";
+        }
+
+        search_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        return result;
+    });
+
+    // The latency includes the time in the queue and
+    // waiting for the game, that's what clients see.
+    std::string result = reply.get();
+    double latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitted).count();
+    stats.RecordGenmove(latency_ms, search_ms);
+
+    return result;
+}
+
+std::string GameServer::Undo(int id)
+{
+    std::shared_ptr<GameEntry> game = FindGame(id);
+    if(!game)
+        return "? unknown game";
+
+    std::lock_guard<std::mutex> lock(game->mutex);
+    game->board.UndoLastMove();
+
+    return "=";
+}
+
+std::string GameServer::SetTime(int id, std::istringstream& args)
+{
+    std::shared_ptr<GameEntry> game = FindGame(id);
+    if(!game)
+        return "? unknown game";
+
+    int milliseconds;
+    if(!(args>>milliseconds) || milliseconds < 0)
+        return "? expected milliseconds";
+
+    std::lock_guard<std::mutex> lock(game->mutex);
+    game->time_budget_ms = milliseconds;
+    game->ai.SetTimeBudget(milliseconds);
+
+    return "=";
+}
+
+std::string GameServer::SearchStatsJson(int id)
+{
+    std::shared_ptr<GameEntry> game = FindGame(id);
+    if(!game)
+        return "? unknown game";
+
+    std::lock_guard<std::mutex> lock(game->mutex);
+    return "= " + game->ai.GetLastSearchStats().ToJson();
+}
+
+std::string GameServer::DeleteGame(int id)
+{
+    std::lock_guard<std::mutex> lock(games_mutex);
+
+    if(games.erase(id) == 0)
+        return "? unknown game";
+
+    return "=";
+}
+
+std::string GameServer::HandleRequest(const std::string& line)
+{
+    std::istringstream args(line);
+
+    std::string command;
+    args>>command;
+
+    if(command == "new")
+        return NewGame();
+    if(command == "stats")
+        return "= " + stats.Summary();
+
+    int id;
+    if(!(args>>id))
+        return "? expected game id";
+
+    if(command == "play")
+        return PlayMove(id, args);
+    if(command == "genmove")
+        return GenerateMove(id);
+    if(command == "undo")
+        return Undo(id);
+    if(command == "time")
+        return SetTime(id, args);
+    if(command == "searchstats")
+        return SearchStatsJson(id);
+    if(command == "delete")
+        return DeleteGame(id);
+
+    return "? unknown command";
+}
+
+void GameServer::ServeClient(ClientConnection *client)
+{
+    int client_socket = client->socket;
+    std::string pending;
+    char buffer[4096];
+
+    while(true)
+    {
+        ssize_t received = recv(client_socket, buffer, sizeof(buffer), 0);
+        if(received <= 0)
+            break;
+
+        pending.append(buffer, received);
+
+        size_t newline;
+        while((newline = pending.find('\n')) != std::string::npos)
+        {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            if(line.empty())
+                continue;
+
+            if(line == "quit")
+            {
+                shutdown(client_socket, SHUT_RDWR);
+                client->done = true;
+                return;
+            }
+
+            std::string reply = HandleRequest(line) + "\n";
+            if(send(client_socket, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+            {
+                client->done = true;
+                return;
+            }
+        }
+    }
+
+    client->done = true;
+}
+
+void GameServer::ReapClients()
+{
+    std::lock_guard<std::mutex> lock(clients_mutex);
+
+    auto finished = std::remove_if(clients.begin(), clients.end(), [](const std::unique_ptr<ClientConnection>& client)
+    {
+        if(!client->done)
+            return false;
+
+        client->thread.join();
+        close(client->socket);
+        return true;
+    });
+    clients.erase(finished, clients.end());
+}
+
+void GameServer::StopClients()
+{
+    std::lock_guard<std::mutex> lock(clients_mutex);
+
+    // Shutting the sockets down wakes up the
+    // client threads blocked in recv.
+    for(auto& client : clients)
+        shutdown(client->socket, SHUT_RDWR);
+
+    for(auto& client : clients)
+    {
+        client->thread.join();
+        close(client->socket);
+    }
+    clients.clear();
+}
+
+
+
+bool GameServer::Run(int port)
+{
+    int listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if(listen_socket < 0)
+        return false;
+
+    int reuse = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(listen_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_socket, 64) < 0)
+    {
+        close(listen_socket);
+        return false;
+    }
+
+    std::cout<<"Serving games on 127.0.0.1:"<<port<<" with "<<search_pool.NumThreads()<<" search threads.\n";
+
+    while(true)
+    {
+        int client_socket = accept(listen_socket, nullptr, nullptr);
+        if(client_socket >= 0)
+        {
+            ReapClients();
+
+            auto client = std::make_unique<ClientConnection>();
+            client->socket = client_socket;
+            client->thread = std::thread(&GameServer::ServeClient, this, client.get());
+
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            clients.push_back(std::move(client));
+            continue;
+        }
+
+        // Errors of a single connection are skipped, only
+        // a broken listening socket stops the server.
+        if(errno == EBADF || errno == EINVAL || errno == ENOTSOCK || errno == EOPNOTSUPP)
+            break;
+    }
+
+    close(listen_socket);
+    StopClients();
+    return true;
+}
@@ -0,0 +1,143 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "board.h"
+#include "ai.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+const int kDefaultServerPort = 6809;
+const int kDefaultTimeBudgetMs = 2000;
+const int kLatencySamples = 4096;
+
+// A single game hosted by the server.
+// The mutex serializes all access to the
+// board and the ai of the game.
+struct GameEntry
+{
+    std::mutex mutex;
+    Board board;
+    Ai ai;
+    int time_budget_ms = kDefaultTimeBudgetMs;
+};
+
+// Throughput and latency numbers for genmove.
+class ServerStats
+{
+public:
+    ServerStats();
+
+    // latency_ms is measured from the request until the
+    // reply, search_ms is the search alone.
+    void RecordGenmove(double latency_ms, double search_ms);
+
+    // Returns the stats as a single line of
+    // key=value pairs.
+    std::string Summary();
+
+private:
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point start_time;
+
+    uint64_t genmoves = 0;
+
+    // The latest kLatencySamples latencies and
+    // search times.
+    std::vector<double> latencies;
+    std::vector<double> search_times;
+    int next_sample = 0;
+};
+
+// A connected client and the thread serving it.
+// The socket is closed once the thread is joined,
+// so its number can't be reused while still in use.
+struct ClientConnection
+{
+    int socket = -1;
+    std::thread thread;
+    std::atomic<bool> done{false};
+};
+
+// Serves many concurrent games over a local TCP socket.
+//
+// The protocol is line based. Every request is a single
+// line and every reply starts with "=" on success or
+// "?" on failure, followed by the result or an error
+// message:
+//
+//   new                    = <game id>
+//   play <id> <x> <y>      =
+//   play <id> pass         =
+//   genmove <id>           = <x> <y> | = pass
+//   undo <id>              =
+//   time <id> <ms>         =
+//   delete <id>            =
+//   searchstats <id>       = {json of the latest search}
+//   stats                  = genmoves=... p99_ms=... search_p99_ms=...
+//   quit                   closes the connection
+//
+// Searches are run on a bounded work stealing pool
+// so that the number of concurrent searches does not
+// depend on the number of connected clients.
+class GameServer
+{
+public:
+    GameServer(int nr_threads, int max_queued_searches);
+    ~GameServer();
+
+    // Listens on 127.0.0.1:port and serves clients
+    // until the process is killed or the listening
+    // socket breaks, in which case the clients are
+    // disconnected and true is returned.
+    // Returns false if the socket couldn't be set up.
+    bool Run(int port);
+
+    // Handles one request line and returns the reply.
+    std::string HandleRequest(const std::string& line);
+
+    // Parameters of the ais of games created
+    // after this call.
+    void SetParameters(const Parameters& value) { parameters = value; }
+
+private:
+    void ServeClient(ClientConnection *client);
+
+    // Joins the threads of disconnected clients.
+    void ReapClients();
+    // Disconnects all clients and joins their threads.
+    void StopClients();
+
+    std::shared_ptr<GameEntry> FindGame(int id);
+
+    std::string NewGame();
+    std::string PlayMove(int id, std::istringstream& args);
+    std::string GenerateMove(int id);
+    std::string Undo(int id);
+    std::string SetTime(int id, std::istringstream& args);
+    std::string SearchStatsJson(int id);
+    std::string DeleteGame(int id);
+
+    std::mutex games_mutex;
+    std::unordered_map<int, std::shared_ptr<GameEntry>> games;
+    int next_game_id = 0;
+
+    Parameters parameters;
+
+    ServerStats stats;
+    ThreadPool search_pool;
+
+    std::mutex clients_mutex;
+    std::vector<std::unique_ptr<ClientConnection>> clients;
+};
+
+#endif
@@ -0,0 +1,304 @@
+#include "sgf.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+std::string_view SgfGame::GetProperty(std::string_view name) const
+{
+    for(const SgfProperty& property : root_properties)
+    {
+        if(property.name == name)
+            return property.value;
+    }
+
+    return std::string_view();
+}
+
+bool SgfReader::Open(const std::string& path)
+{
+    if(!file.Open(path))
+        return false;
+
+    SetText(file.View());
+    return true;
+}
+
+void SgfReader::SetText(std::string_view new_text)
+{
+    text = new_text;
+    position = 0;
+    failed = false;
+}
+
+void SgfReader::SkipWhitespace()
+{
+    while(position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+        ++position;
+}
+
+bool SgfReader::NextGame(SgfGame *game)
+{
+    game->root_properties.clear();
+    game->moves.clear();
+    game->has_setup = false;
+
+    if(failed)
+        return false;
+
+    // Anything between game trees is ignored.
+    while(position < text.size() && text[position] != '(')
+        ++position;
+
+    if(position >= text.size())
+        return false;
+
+    bool is_root = true;
+    if(!ParseGameTree(game, true, &is_root))
+    {
+        failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool SgfReader::ParseGameTree(SgfGame *game, bool main_line, bool *is_root)
+{
+    // Skip the '('.
+    ++position;
+
+    bool first_variation = true;
+
+    while(true)
+    {
+        SkipWhitespace();
+        if(position >= text.size())
+            return false;
+
+        char c = text[position];
+        if(c == ';')
+        {
+            ++position;
+            if(!ParseNode(game, main_line, *is_root))
+                return false;
+
+            *is_root = false;
+        }
+        else if(c == '(')
+        {
+            // Only the first variation continues the main line.
+            if(!ParseGameTree(game, main_line && first_variation, is_root))
+                return false;
+
+            first_variation = false;
+        }
+        else if(c == ')')
+        {
+            ++position;
+            return true;
+        }
+        else
+            return false;
+    }
+}
+
+bool SgfReader::ParseNode(SgfGame *game, bool main_line, bool is_root)
+{
+    while(true)
+    {
+        SkipWhitespace();
+        if(position >= text.size())
+            return false;
+
+        if(!std::isupper(static_cast<unsigned char>(text[position])))
+            return true;
+
+        size_t name_start = position;
+        while(position < text.size() && std::isalpha(static_cast<unsigned char>(text[position])))
+            ++position;
+
+        std::string_view name = text.substr(name_start, position - name_start);
+
+        SkipWhitespace();
+        if(position >= text.size() || text[position] != '[')
+            return false;
+
+        while(position < text.size() && text[position] == '[')
+        {
+            std::string_view value;
+            if(!ParseValue(&value))
+                return false;
+
+            if(main_line)
+            {
+                if(name == "B" || name == "W")
+                    game->moves.push_back({name, value});
+                else if(name == "AB" || name == "AW" || name == "AE")
+                    game->has_setup = true;
+                else if(is_root)
+                    game->root_properties.push_back({name, value});
+            }
+
+            SkipWhitespace();
+        }
+    }
+}
+
+bool SgfReader::ParseValue(std::string_view *value)
+{
+    // Skip the '['.
+    ++position;
+
+    size_t value_start = position;
+    while(position < text.size() && text[position] != ']')
+    {
+        // An escaped character can't end the value.
+        if(text[position] == '\\')
+            ++position;
+
+        ++position;
+    }
+
+    if(position >= text.size())
+        return false;
+
+    *value = text.substr(value_start, position - value_start);
+
+    // Skip the ']'.
+    ++position;
+
+    return true;
+}
+
+static bool ParsePoint(std::string_view value, Coordinate *point)
+{
+    // Both an empty value and "tt" mean pass.
+    if(value.empty() || (kBoardSize <= 19 && value == "tt"))
+    {
+        *point = kPassMove;
+        return true;
+    }
+
+    if(value.size() != 2)
+        return false;
+
+    int x = value[0] - 'a';
+    int y = value[1] - 'a';
+
+    if(x < 0 || x >= kBoardSize || y < 0 || y >= kBoardSize)
+        return false;
+
+    *point = {x,y};
+    return true;
+}
+
+static void ParseResult(std::string_view result, GameRecord *record)
+{
+    record->winner = EMPTY;
+    record->score = 0;
+    record->resigned = false;
+
+    if(result.size() < 2 || result[1] != '+')
+        return;
+
+    if(result[0] == 'B')
+        record->winner = BLACK;
+    else if(result[0] == 'W')
+        record->winner = WHITE;
+    else
+        return;
+
+    std::string_view margin = result.substr(2);
+    if(!margin.empty() && (margin[0] == 'R' || margin[0] == 'r'))
+    {
+        record->resigned = true;
+        return;
+    }
+
+    record->score = std::strtof(std::string(margin).c_str(), nullptr);
+}
+
+bool SgfToRecord(const SgfGame& game, GameRecord *record)
+{
+    std::string_view size = game.GetProperty("SZ");
+    if(!size.empty() && std::atoi(std::string(size).c_str()) != kBoardSize)
+        return false;
+
+    if(game.has_setup)
+        return false;
+
+    *record = GameRecord();
+
+    std::string_view rules = game.GetProperty("RU");
+    if(rules == "Chinese" || rules == "chinese")
+        record->rules = CHINESE_RULES;
+
+    std::string_view komi = game.GetProperty("KM");
+    if(!komi.empty())
+        record->komi = std::strtof(std::string(komi).c_str(), nullptr);
+
+    ParseResult(game.GetProperty("RE"), record);
+
+    int side = BLACK;
+    for(const SgfProperty& move : game.moves)
+    {
+        int color = (move.name == "B")?BLACK:WHITE;
+
+        // Two moves in a row by the same side
+        // means the other side passed in between.
+        if(color != side)
+            record->moves.push_back(kPassMove);
+
+        Coordinate point;
+        if(!ParsePoint(move.value, &point))
+            return false;
+
+        record->moves.push_back(point);
+        side = (color == BLACK)?WHITE:BLACK;
+    }
+
+    return true;
+}
+
+std::string SgfResult(const GameRecord& record)
+{
+    if(record.winner != BLACK && record.winner != WHITE)
+        return "0";
+
+    std::ostringstream result;
+    result<<((record.winner == BLACK)?"B+":"W+");
+
+    if(record.resigned)
+        result<<"R";
+    else
+        result<<record.score;
+
+    return result.str();
+}
+
+void SgfWriter::Write(const GameRecord& record)
+{
+    *out<<"(;GM[1]FF[4]SZ["<<kBoardSize<<"]";
+    *out<<"RU["<<((record.rules == CHINESE_RULES)?"Chinese":"Japanese")<<"]";
+    *out<<"KM["<<record.komi<<"]";
+    *out<<"RE["<<SgfResult(record)<<"]\n";
+
+    int side = BLACK;
+    for(size_t i = 0; i < record.moves.size(); ++i)
+    {
+        const Coordinate& move = record.moves[i];
+
+        *out<<";"<<((side == BLACK)?"B":"W")<<"[";
+        if(!(move == kPassMove))
+            *out<<static_cast<char>('a' + move.x)<<static_cast<char>('a' + move.y);
+        *out<<"]";
+
+        if(i % 10 == 9)
+            *out<<"\n";
+
+        side = (side == BLACK)?WHITE:BLACK;
+    }
+
+    *out<<")\n";
+}
@@ -0,0 +1,99 @@
+#ifndef SGF_H
+#define SGF_H
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "game_record.h"
+#include "mapped_file.h"
+
+// A single property value, e.g. B[cc] is
+// {"B","cc"}. Properties with several values
+// are stored as one entry per value.
+//
+// The views point into the text the game was
+// read from and are only valid as long as the
+// reader is. Escapes such as \] are not resolved.
+struct SgfProperty
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+struct SgfGame
+{
+    // Properties of the root node, e.g. SZ, KM and RE.
+    std::vector<SgfProperty> root_properties;
+
+    // The B and W properties of the main line in order.
+    // Variations other than the first one are skipped.
+    std::vector<SgfProperty> moves;
+
+    // Set if the game places stones with AB, AW or AE.
+    bool has_setup = false;
+
+    // Returns the first value of the root property
+    // or an empty view if there is none.
+    std::string_view GetProperty(std::string_view name) const;
+};
+
+// Reads the games of an SGF collection one at a time.
+//
+// The file is memory mapped and every game is parsed
+// only when it is asked for, so collections of any
+// size can be streamed in constant memory.
+class SgfReader
+{
+public:
+    // Maps the file. Returns false if it couldn't be opened.
+    bool Open(const std::string& path);
+
+    // Reads games from text that is owned by the caller.
+    void SetText(std::string_view text);
+
+    // Parses the next game into *game.
+    // Returns false when there are no more games
+    // or the input is malformed, see Failed().
+    bool NextGame(SgfGame *game);
+
+    // True if reading stopped because of a syntax error.
+    bool Failed() const { return failed; }
+
+    // The byte offset the reader has reached.
+    size_t Position() const { return position; }
+
+private:
+    bool ParseGameTree(SgfGame *game, bool main_line, bool *is_root);
+    bool ParseNode(SgfGame *game, bool main_line, bool is_root);
+    bool ParseValue(std::string_view *value);
+    void SkipWhitespace();
+
+    MappedFile file;
+    std::string_view text;
+    size_t position = 0;
+    bool failed = false;
+};
+
+// Converts a parsed SGF game to a game record.
+// Returns false if the game is not a 9x9 game,
+// uses setup stones or contains invalid moves.
+bool SgfToRecord(const SgfGame& game, GameRecord *record);
+
+// Writes game records as an SGF collection.
+class SgfWriter
+{
+public:
+    explicit SgfWriter(std::ostream *out) : out(out) {}
+
+    void Write(const GameRecord& record);
+
+private:
+    std::ostream *out;
+};
+
+// Returns the SGF result string, e.g. "B+3.5" or "W+R".
+std::string SgfResult(const GameRecord& record);
+
+#endif
@@ -0,0 +1,171 @@
+#include "spsa.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // A tuned parameter with its perturbation size
+    // and the range it is kept in. Integer parameters
+    // are tuned as floats and rounded when used.
+    struct Tunable
+    {
+        const char *name;
+        float Parameters::*float_value;
+        int Parameters::*int_value;
+        double c;
+        double min;
+        double max;
+    };
+
+    const Tunable kTunables[] =
+    {
+        {"captures_weight", &Parameters::captures_weight, nullptr, 0.2, 0, 10},
+        {"territory_weight", &Parameters::territory_weight, nullptr, 0.2, 0, 10},
+        {"liberties_weight", &Parameters::liberties_weight, nullptr, 0.2, 0, 10},
+        {"influence_weight", &Parameters::influence_weight, nullptr, 0.2, 0, 10},
+        {"edge_point_evaluation", nullptr, &Parameters::edge_point_evaluation, 1, 1, 10},
+    };
+
+    const int kNumTunables = sizeof(kTunables)/sizeof(kTunables[0]);
+
+    // Usual SPSA decay exponents.
+    const double kAlpha = 0.602;
+    const double kGamma = 0.101;
+
+    typedef std::vector<double> Theta;
+
+    // The size of the perturbation at a point of the c_k
+    // schedule. Integer parameters are perturbed by at least
+    // 1, or both sides would round to the same value and
+    // the gradient would be 0.
+    double Perturbation(const Tunable& tunable, double c_k)
+    {
+        double size = c_k*tunable.c;
+        if(tunable.int_value != nullptr)
+            size = std::max(size, 1.0);
+        return size;
+    }
+
+    Theta GetTheta(const Parameters& parameters)
+    {
+        Theta theta;
+        for(const Tunable& tunable : kTunables)
+        {
+            if(tunable.float_value != nullptr)
+                theta.push_back(parameters.*tunable.float_value);
+            else
+                theta.push_back(parameters.*tunable.int_value);
+        }
+        return theta;
+    }
+
+    Parameters WithTheta(Parameters parameters, const Theta& theta)
+    {
+        for(int i = 0; i < kNumTunables; ++i)
+        {
+            const Tunable& tunable = kTunables[i];
+            double value = std::max(tunable.min, std::min(tunable.max, theta[i]));
+
+            if(tunable.float_value != nullptr)
+                parameters.*tunable.float_value = static_cast<float>(value);
+            else
+                parameters.*tunable.int_value = static_cast<int>(std::lround(value));
+        }
+        return parameters;
+    }
+
+    void PrintTheta(int iteration, int plus_wins, int minus_wins, const Parameters& parameters, double seconds)
+    {
+        std::cout<<"Iteration "<<iteration<<": "<<plus_wins<<"-"<<minus_wins<<" in "<<seconds<<" s,";
+        for(const Tunable& tunable : kTunables)
+        {
+            std::cout<<" "<<tunable.name<<"=";
+            if(tunable.float_value != nullptr)
+                std::cout<<parameters.*tunable.float_value;
+            else
+                std::cout<<parameters.*tunable.int_value;
+        }
+        std::cout<<std::endl;
+    }
+}
+
+Parameters RunSpsa(const Parameters& start, const SpsaOptions& options)
+{
+    int pairs = std::max(1, (options.games_per_iteration + 1)/2);
+
+    ThreadPool pool(options.threads, pairs*2);
+    std::mt19937 rng(options.seed);
+
+    Theta theta = GetTheta(start);
+
+    // Stability constant of the step size schedule,
+    // about a tenth of the planned iterations.
+    double big_a = (options.iterations > 0)?options.iterations/10.0:100;
+
+    for(int k = 0; options.iterations == 0 || k < options.iterations; ++k)
+    {
+        auto iteration_start = std::chrono::steady_clock::now();
+
+        double a_k = options.learning_rate/std::pow(k + 1 + big_a, kAlpha)*std::pow(big_a + 1, kAlpha);
+        double c_k = 1/std::pow(k + 1, kGamma);
+
+        Theta delta(kNumTunables);
+        Theta plus_theta = theta;
+        Theta minus_theta = theta;
+        for(int i = 0; i < kNumTunables; ++i)
+        {
+            delta[i] = (rng() & 1)?1:-1;
+            plus_theta[i] += Perturbation(kTunables[i], c_k)*delta[i];
+            minus_theta[i] -= Perturbation(kTunables[i], c_k)*delta[i];
+        }
+
+        Parameters plus = WithTheta(start, plus_theta);
+        Parameters minus = WithTheta(start, minus_theta);
+        plus.search_depth = options.search_depth;
+        minus.search_depth = options.search_depth;
+
+        // Every opening is played with both colors.
+        std::vector<std::future<int>> plus_as_black;
+        std::vector<std::future<int>> plus_as_white;
+        for(int game = 0; game < pairs; ++game)
+        {
+            uint32_t seed = rng();
+            const SelfPlayOptions& self_play = options.self_play;
+
+            plus_as_black.push_back(pool.Submit([=]() { return PlaySelfPlayGame(plus, minus, seed, self_play); }));
+            plus_as_white.push_back(pool.Submit([=]() { return PlaySelfPlayGame(minus, plus, seed, self_play); }));
+        }
+
+        int plus_wins = 0;
+        for(auto& result : plus_as_black)
+            plus_wins += (result.get() == BLACK)?1:0;
+        for(auto& result : plus_as_white)
+            plus_wins += (result.get() == WHITE)?1:0;
+
+        int minus_wins = pairs*2 - plus_wins;
+        double result = static_cast<double>(plus_wins - minus_wins)/(pairs*2);
+
+        for(int i = 0; i < kNumTunables; ++i)
+        {
+            theta[i] += a_k*Perturbation(kTunables[i], c_k)*result*delta[i];
+            theta[i] = std::max(kTunables[i].min, std::min(kTunables[i].max, theta[i]));
+        }
+
+        Parameters current = WithTheta(start, theta);
+
+        if(!options.output_path.empty() && !SaveParameters(options.output_path, current))
+            std::cout<<"Couldn't write "<<options.output_path<<".\n";
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - iteration_start).count();
+        PrintTheta(k, plus_wins, minus_wins, current, seconds);
+    }
+
+    return WithTheta(start, theta);
+}
@@ -0,0 +1,49 @@
+#ifndef SPSA_H
+#define SPSA_H
+
+#include <cstdint>
+#include <string>
+
+#include "parameters.h"
+#include "self_play.h"
+
+// Tunes the evaluation weights by simultaneous
+// perturbation stochastic approximation.
+//
+// Every iteration moves all weights at once by a
+// random +-c and plays a batch of games between the
+// two perturbed versions. The weights then take a
+// step towards the version that won more games. The
+// games of a batch are played in parallel, each
+// opening twice with the colors swapped.
+
+struct SpsaOptions
+{
+    // 0 keeps tuning until the process is killed.
+    int iterations = 1000;
+
+    // Rounded up to an even number.
+    int games_per_iteration = 16;
+
+    int threads = 1;
+    uint32_t seed = 1;
+
+    // Step size, relative to the perturbation of each
+    // weight, when one side wins every game of a batch.
+    float learning_rate = 0.5;
+
+    // Search depth of the self-play games. The tuned
+    // parameters keep their own depth.
+    int search_depth = 2;
+
+    SelfPlayOptions self_play;
+
+    // The weights are written here after every
+    // iteration, if the path is not empty.
+    std::string output_path;
+};
+
+// Returns the tuned parameters.
+Parameters RunSpsa(const Parameters& start, const SpsaOptions& options);
+
+#endif
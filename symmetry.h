@@ -0,0 +1,48 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <utility>
+
+#include "board.h"
+
+// The symmetries are numbered from 0 to kNumSymmetries-1
+// and symmetry 0 is the identity.
+
+// Returns the point that c is moved to by the symmetry.
+inline Coordinate TransformPoint(const Coordinate& c, int symmetry)
+{
+    const int last = kBoardSize - 1;
+
+    int x = c.x;
+    int y = c.y;
+
+    // Bit 2 transposes, bit 1 mirrors x and bit 0 mirrors y.
+    if(symmetry & 4)
+        std::swap(x, y);
+    if(symmetry & 2)
+        x = last - x;
+    if(symmetry & 1)
+        y = last - y;
+
+    return {x,y};
+}
+
+// Returns the point that is moved to c by the symmetry.
+inline Coordinate InverseTransformPoint(const Coordinate& c, int symmetry)
+{
+    const int last = kBoardSize - 1;
+
+    int x = c.x;
+    int y = c.y;
+
+    if(symmetry & 1)
+        y = last - y;
+    if(symmetry & 2)
+        x = last - x;
+    if(symmetry & 4)
+        std::swap(x, y);
+
+    return {x,y};
+}
+
+#endif
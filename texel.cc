@@ -0,0 +1,364 @@
+#include "texel.h"
+#include "game_record.h"
+#include "record_file.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    const int kNumFeatures = 4;
+
+    struct Row
+    {
+        uint64_t hash;
+        std::array<float,kNumFeatures> features;
+        float result;
+        int count;
+
+        bool operator<(const Row& other) const
+        {
+            if(hash != other.hash)
+                return hash < other.hash;
+            return features < other.features;
+        }
+
+        bool SamePosition(const Row& other) const
+        {
+            return hash == other.hash && features == other.features;
+        }
+    };
+
+    void ExtractGame(const GameRecord& record, const Parameters& parameters, int skip_plies, std::vector<Row> *rows)
+    {
+        float result = (record.winner == BLACK)?1:0;
+
+        Board board;
+        for(size_t ply = 0; ply < record.moves.size(); ++ply)
+        {
+            const Coordinate& move = record.moves[ply];
+            if(move == kPassMove)
+                board.Pass();
+            else if(!board.MakeMove(move))
+                return;
+
+            if(static_cast<int>(ply) + 1 < skip_plies)
+                continue;
+
+            EvaluationFeatures features;
+            board.GetEvaluationFeatures(&features, parameters);
+
+            int symmetry;
+            Row row;
+            row.hash = board.GetCanonicalHash(&symmetry);
+            row.features = {{features.influence, features.liberties, features.captures, features.territory}};
+            row.result = result;
+            row.count = 1;
+            rows->push_back(row);
+        }
+    }
+
+    // The weights in the order of the feature columns.
+    std::array<double,kNumFeatures> GetWeights(const Parameters& parameters)
+    {
+        return {{parameters.influence_weight, parameters.liberties_weight, parameters.captures_weight, parameters.territory_weight}};
+    }
+
+    // Mean loss followed by its gradient for the weights.
+    typedef std::array<double,kNumFeatures + 1> LossAndGradient;
+
+    // e^-|z| without calls into libm or float compares, so
+    // that loops using it vectorize. |z| is capped at 87,
+    // the result stays a normal float. The relative error is
+    // below 3e-7.
+    inline float ExpNegativeAbs(float z)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &z, sizeof(bits));
+        bits &= 0x7fffffffu;
+        bits = (bits > 0x42ae0000u)?0x42ae0000u:bits;
+
+        float x;
+        std::memcpy(&x, &bits, sizeof(x));
+        x = -x;
+
+        // x = n*ln(2) + r with |r| <= ln(2)/2. Adding and
+        // subtracting 1.5*2^23 rounds to the nearest integer.
+        float n = (x*1.44269504f + 12582912.0f) - 12582912.0f;
+        float r = x - n*0.693145752f - n*1.42860677e-6f;
+
+        float e = 1 + r*(1 + r*(0.5f + r*(0.166666672f + r*(0.0416666679f + r*(0.00833333377f + r*0.00138888892f)))));
+
+        int32_t scale_bits = (static_cast<int32_t>(n) + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &scale_bits, sizeof(scale));
+
+        return e*scale;
+    }
+
+    // ln(1 + u) for u in [0, 1], as 2*atanh(s) with
+    // s = u/(2 + u) no larger than 1/3.
+    inline float LogOnePlus(float u)
+    {
+        float s = u/(2 + u);
+        float s2 = s*s;
+        return 2*s*(1 + s2*(0.333333343f + s2*(0.2f + s2*(0.142857149f + s2*(0.111111112f + s2*0.0909090936f)))));
+    }
+
+    // Rows are handled kLanes at a time with an accumulator
+    // per lane, so that the inner loop vectorizes without
+    // reordering a float sum. Blocks of kBlockRows rows are
+    // added up in float and then moved to the double totals.
+    const size_t kLanes = 8;
+    const size_t kBlockRows = 1024;
+
+    LossAndGradient ChunkLoss(const FeatureMatrix& matrix, size_t begin, size_t end, const std::array<double,kNumFeatures>& weights, double scale)
+    {
+        const float *influence = matrix.influence.data();
+        const float *liberties = matrix.liberties.data();
+        const float *captures = matrix.captures.data();
+        const float *territory = matrix.territory.data();
+        const float *results = matrix.results.data();
+
+        float w0 = weights[0];
+        float w1 = weights[1];
+        float w2 = weights[2];
+        float w3 = weights[3];
+        float k = scale;
+
+        // The log loss of the logit z = k*eval is written as
+        // max(z,0) + ln(1 + e^-|z|) - y*z, which needs no
+        // clamping of the probability. Nothing branches on
+        // floats, since compares that may trap keep the
+        // compiler from vectorizing.
+        auto row = [&](size_t i, float *loss, float *g0, float *g1, float *g2, float *g3)
+        {
+            float z = k*(influence[i]*w0 + liberties[i]*w1 + captures[i]*w2 + territory[i]*w3 - kKomi);
+            float u = ExpNegativeAbs(z);
+            float p = 0.5f + std::copysign(1/(1 + u) - 0.5f, z);
+
+            float y = results[i];
+            *loss += 0.5f*(z + std::fabs(z)) + LogOnePlus(u) - y*z;
+
+            float d = p - y;
+            *g0 += d*influence[i];
+            *g1 += d*liberties[i];
+            *g2 += d*captures[i];
+            *g3 += d*territory[i];
+        };
+
+        LossAndGradient total = {{0}};
+
+        size_t i = begin;
+        while(i + kLanes <= end)
+        {
+            float loss[kLanes] = {0};
+            float g0[kLanes] = {0};
+            float g1[kLanes] = {0};
+            float g2[kLanes] = {0};
+            float g3[kLanes] = {0};
+
+            size_t block_end = std::min(end, i + kBlockRows);
+            for(; i + kLanes <= block_end; i += kLanes)
+            {
+                for(size_t lane = 0; lane < kLanes; ++lane)
+                    row(i + lane, &loss[lane], &g0[lane], &g1[lane], &g2[lane], &g3[lane]);
+            }
+
+            for(size_t lane = 0; lane < kLanes; ++lane)
+            {
+                total[0] += loss[lane];
+                total[1] += g0[lane];
+                total[2] += g1[lane];
+                total[3] += g2[lane];
+                total[4] += g3[lane];
+            }
+        }
+
+        float loss = 0, g0 = 0, g1 = 0, g2 = 0, g3 = 0;
+        for(; i < end; ++i)
+            row(i, &loss, &g0, &g1, &g2, &g3);
+
+        return {{total[0] + loss, k*(total[1] + g0), k*(total[2] + g1), k*(total[3] + g2), k*(total[4] + g3)}};
+    }
+
+    // Splits the rows over the pool and returns
+    // the mean loss and gradient.
+    LossAndGradient Loss(const FeatureMatrix& matrix, const std::array<double,kNumFeatures>& weights, double scale, ThreadPool *pool)
+    {
+        size_t chunks = pool->NumThreads();
+        size_t chunk_size = (matrix.Size() + chunks - 1)/chunks;
+
+        std::vector<std::future<LossAndGradient>> parts;
+        for(size_t begin = 0; begin < matrix.Size(); begin += chunk_size)
+        {
+            size_t end = std::min(matrix.Size(), begin + chunk_size);
+            parts.push_back(pool->Submit([&matrix, begin, end, weights, scale]() { return ChunkLoss(matrix, begin, end, weights, scale); }));
+        }
+
+        LossAndGradient total = {{0}};
+        for(auto& part : parts)
+        {
+            LossAndGradient values = part.get();
+            for(int i = 0; i < kNumFeatures + 1; ++i)
+                total[i] += values[i];
+        }
+
+        for(double& value : total)
+            value /= std::max<size_t>(1, matrix.Size());
+
+        return total;
+    }
+
+    // The scale maps evaluations to win probabilities.
+    // It is fitted once for the starting weights by a
+    // golden section search and then kept fixed, since
+    // it would otherwise trade off against the weights.
+    double FitScale(const FeatureMatrix& matrix, const std::array<double,kNumFeatures>& weights, ThreadPool *pool)
+    {
+        const double kRatio = 0.618033988749895;
+
+        double low = 0.001;
+        double high = 2;
+
+        for(int i = 0; i < 40; ++i)
+        {
+            double a = high - kRatio*(high - low);
+            double b = low + kRatio*(high - low);
+
+            if(Loss(matrix, weights, a, pool)[0] < Loss(matrix, weights, b, pool)[0])
+                high = b;
+            else
+                low = a;
+        }
+
+        return (low + high)/2;
+    }
+}
+
+bool ExtractFeatures(const std::string& record_path, const Parameters& parameters, const TexelOptions& options, FeatureMatrix *matrix)
+{
+    RecordReader reader;
+    if(!reader.Open(record_path))
+        return false;
+
+    int nr_threads = std::max(1, options.threads);
+    std::vector<std::vector<Row>> thread_rows(nr_threads);
+    std::atomic<uint64_t> next_game{0};
+
+    auto worker = [&](int thread)
+    {
+        GameRecord record;
+        uint64_t game;
+        while((game = next_game++) < reader.NumGames())
+        {
+            if(reader.GetGame(game, &record) && record.winner != EMPTY)
+                ExtractGame(record, parameters, options.skip_plies, &thread_rows[thread]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(int i = 1; i < nr_threads; ++i)
+        threads.emplace_back(worker, i);
+
+    worker(0);
+
+    for(auto& thread : threads)
+        thread.join();
+
+    std::vector<Row> rows;
+    for(auto& part : thread_rows)
+    {
+        rows.insert(rows.end(), part.begin(), part.end());
+        std::vector<Row>().swap(part);
+    }
+
+    // Merge repeated positions, averaging their results.
+    std::sort(rows.begin(), rows.end());
+
+    size_t merged = 0;
+    for(size_t i = 0; i < rows.size(); ++i)
+    {
+        if(merged > 0 && rows[merged-1].SamePosition(rows[i]))
+        {
+            Row& row = rows[merged-1];
+            row.result = (row.result*row.count + rows[i].result)/(row.count + 1);
+            ++row.count;
+        }
+        else
+            rows[merged++] = rows[i];
+    }
+    rows.resize(merged);
+
+    *matrix = FeatureMatrix();
+    for(const Row& row : rows)
+    {
+        matrix->influence.push_back(row.features[0]);
+        matrix->liberties.push_back(row.features[1]);
+        matrix->captures.push_back(row.features[2]);
+        matrix->territory.push_back(row.features[3]);
+        matrix->results.push_back(row.result);
+    }
+
+    return true;
+}
+
+Parameters RunTexelTuning(const FeatureMatrix& matrix, const Parameters& start, const TexelOptions& options)
+{
+    if(matrix.Size() == 0)
+        return start;
+
+    ThreadPool pool(options.threads, options.threads);
+
+    std::array<double,kNumFeatures> weights = GetWeights(start);
+    double scale = FitScale(matrix, weights, &pool);
+
+    std::cout<<"Positions: "<<matrix.Size()<<", scale: "<<scale<<", loss: "<<Loss(matrix, weights, scale, &pool)[0]<<"\n";
+
+    // Adam keeps the step size sensible for features
+    // of very different ranges, e.g. a sign next to
+    // a territory count.
+    const double kBeta1 = 0.9;
+    const double kBeta2 = 0.999;
+    const double kEpsilon = 1e-8;
+
+    std::array<double,kNumFeatures> m = {{0}};
+    std::array<double,kNumFeatures> v = {{0}};
+
+    for(int epoch = 1; epoch <= options.epochs; ++epoch)
+    {
+        LossAndGradient loss = Loss(matrix, weights, scale, &pool);
+
+        for(int i = 0; i < kNumFeatures; ++i)
+        {
+            double gradient = loss[i+1];
+            m[i] = kBeta1*m[i] + (1 - kBeta1)*gradient;
+            v[i] = kBeta2*v[i] + (1 - kBeta2)*gradient*gradient;
+
+            double m_hat = m[i]/(1 - std::pow(kBeta1, epoch));
+            double v_hat = v[i]/(1 - std::pow(kBeta2, epoch));
+            weights[i] -= options.learning_rate*m_hat/(std::sqrt(v_hat) + kEpsilon);
+        }
+
+        if(epoch % 100 == 0 || epoch == options.epochs)
+            std::cout<<"Epoch "<<epoch<<": loss "<<loss[0]<<"\n";
+    }
+
+    Parameters tuned = start;
+    tuned.influence_weight = weights[0];
+    tuned.liberties_weight = weights[1];
+    tuned.captures_weight = weights[2];
+    tuned.territory_weight = weights[3];
+
+    if(!options.output_path.empty() && !SaveParameters(options.output_path, tuned))
+        std::cout<<"Couldn't write "<<options.output_path<<".\n";
+
+    return tuned;
+}
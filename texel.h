@@ -0,0 +1,65 @@
+#ifndef TEXEL_H
+#define TEXEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "parameters.h"
+
+// Fits the evaluation weights to the results of
+// recorded games.
+//
+// Board::Evaluate is linear in its weights, so the
+// features of every position are extracted once.
+// The weights are then fitted by gradient descent
+// on the logistic loss between sigmoid(scale*eval)
+// and the game results, which only needs passes
+// over the feature columns.
+
+struct TexelOptions
+{
+    int threads = 1;
+    int epochs = 2000;
+
+    // Step size of the Adam updates.
+    float learning_rate = 0.01;
+
+    // Positions before this ply are left out,
+    // they say little about the result.
+    int skip_plies = 10;
+
+    // The weights are written here when done,
+    // if the path is not empty.
+    std::string output_path;
+};
+
+// The extracted positions, one column per
+// feature so that the loss is a few tight loops.
+struct FeatureMatrix
+{
+    std::vector<float> influence;
+    std::vector<float> liberties;
+    std::vector<float> captures;
+    std::vector<float> territory;
+
+    // 1 for a black win, 0 for a white win. Positions
+    // seen in several games get the mean result.
+    std::vector<float> results;
+
+    size_t Size() const { return results.size(); }
+};
+
+// Replays the games of a record file and extracts
+// the features of their positions. Games without a
+// known winner are skipped. Positions that are
+// symmetric to each other are merged. Returns false
+// if the file couldn't be read.
+bool ExtractFeatures(const std::string& record_path, const Parameters& parameters, const TexelOptions& options, FeatureMatrix *matrix);
+
+// Returns the tuned parameters. Only the four
+// evaluation weights are changed.
+Parameters RunTexelTuning(const FeatureMatrix& matrix, const Parameters& start, const TexelOptions& options);
+
+#endif
@@ -0,0 +1,123 @@
+#include "thread_pool.h"
+
+namespace
+{
+    // The pool the current thread works for, if any.
+    thread_local const ThreadPool *worker_of = nullptr;
+}
+
+ThreadPool::ThreadPool(int nr_threads, int max_queued_tasks)
+{
+    if(nr_threads < 1)
+        nr_threads = 1;
+
+    max_queued = (max_queued_tasks < 1)?1:max_queued_tasks;
+
+    for(int i = 0; i < nr_threads; ++i)
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+
+    for(int i = 0; i < nr_threads; ++i)
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    space_available.notify_all();
+
+    for(auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::Push(std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> lock(state_mutex);
+
+        // Every worker could end up here waiting for space
+        // that only the workers make, so run it inline.
+        if(worker_of == this && !stopping && queued_tasks >= max_queued)
+        {
+            lock.unlock();
+            task();
+            return;
+        }
+
+        space_available.wait(lock, [this]() { return stopping || queued_tasks < max_queued; });
+        ++queued_tasks;
+    }
+
+    WorkQueue& queue = *queues[next_queue++ % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    work_available.notify_one();
+}
+
+bool ThreadPool::PopOrSteal(int worker, std::function<void()> *task)
+{
+    // Own queue first, newest task first since
+    // it is the most likely to be cache warm.
+    {
+        WorkQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest task of some other worker.
+    int nr_queues = static_cast<int>(queues.size());
+    for(int i = 1; i < nr_queues; ++i)
+    {
+        WorkQueue& other = *queues[(worker + i) % nr_queues];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if(!other.tasks.empty())
+        {
+            *task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::WorkerLoop(int worker)
+{
+    worker_of = this;
+
+    while(true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(state_mutex);
+            work_available.wait(lock, [this]() { return stopping || queued_tasks > 0; });
+
+            if(queued_tasks == 0)
+                return;
+
+            // Claim a task while holding the lock so
+            // that it is guaranteed to be found below.
+            --queued_tasks;
+        }
+        space_available.notify_one();
+
+        // The claimed task may still be on its way
+        // into a queue, so keep looking until it shows up.
+        while(!PopOrSteal(worker, &task))
+            std::this_thread::yield();
+
+        task();
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed size pool of worker threads.
+//
+// Every worker owns a queue of tasks. New tasks
+// are spread over the queues round robin and a
+// worker that runs out of work steals from the
+// other queues. The total number of queued tasks
+// is bounded so that a flood of requests blocks
+// the submitter instead of growing without limit.
+class ThreadPool
+{
+public:
+    ThreadPool(int nr_threads, int max_queued_tasks);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a task and returns a future for its result.
+    // Blocks while the pool already holds max_queued_tasks,
+    // except on the pool's own workers: a full pool runs
+    // their tasks inline, since a blocked worker could be
+    // waiting for itself. Waiting on the future from a
+    // task can still deadlock if all the workers do it.
+    template<typename F>
+    auto Submit(F task) -> std::future<decltype(task())>
+    {
+        using Result = decltype(task());
+
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+
+        Push([packaged]() { (*packaged)(); });
+
+        return result;
+    }
+
+    int NumThreads() const { return static_cast<int>(workers.size()); }
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Push(std::function<void()> task);
+    bool PopOrSteal(int worker, std::function<void()> *task);
+    void WorkerLoop(int worker);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+
+    // Guards the counters below and is used with
+    // the condition variables for sleeping.
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable space_available;
+
+    int queued_tasks = 0;
+    int max_queued = 0;
+    bool stopping = false;
+
+    std::atomic<unsigned> next_queue{0};
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "zobrist.h"
+#include "board.h"
+#include "symmetry.h"
+
+#include <array>
+
+namespace
+{
+    const uint64_t kZobristSeed = 0x9E3779B97F4A7C15ULL;
+
+    // SplitMix64, the table must be the same on every platform
+    // so the standard library engines can't be used.
+    uint64_t NextKey(uint64_t *state)
+    {
+        uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    struct KeyTable
+    {
+        std::array<std::array<uint64_t,kBoardSize*kBoardSize>,NUM_COLORS> stones;
+        std::array<std::array<std::array<uint64_t,kNumSymmetries>,kBoardSize*kBoardSize>,NUM_COLORS> symmetric_stones;
+        uint64_t side;
+
+        KeyTable()
+        {
+            uint64_t state = kZobristSeed;
+            for(auto& color : stones)
+            {
+                for(auto& key : color)
+                    key = NextKey(&state);
+            }
+            side = NextKey(&state);
+
+            for(int color = 0; color < NUM_COLORS; ++color)
+            {
+                for(int point = 0; point < kBoardSize*kBoardSize; ++point)
+                {
+                    Coordinate c = Coordinate::Get2dCoordinate(point);
+                    for(int s = 0; s < kNumSymmetries; ++s)
+                        symmetric_stones[color][point][s] = stones[color][TransformPoint(c, s).As1D()];
+                }
+            }
+        }
+    };
+
+    const KeyTable& Keys()
+    {
+        static const KeyTable keys;
+        return keys;
+    }
+}
+
+uint64_t Zobrist::StoneKey(int color, int point)
+{
+    return Keys().stones[color][point];
+}
+
+const uint64_t* Zobrist::SymmetricStoneKeys(int color, int point)
+{
+    return Keys().symmetric_stones[color][point].data();
+}
+
+uint64_t Zobrist::SideKey()
+{
+    return Keys().side;
+}
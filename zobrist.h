@@ -0,0 +1,23 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+// Random keys for hashing positions. The keys are
+// generated from a fixed seed so that hashes are the
+// same in every run and can be stored in files.
+namespace Zobrist
+{
+    // Key for a stone of the given color on a 1d point.
+    uint64_t StoneKey(int color, int point);
+
+    // The keys of a stone of the given color on a 1d
+    // point as seen through each of the 8 symmetries,
+    // i.e. StoneKey of the transformed point.
+    const uint64_t* SymmetricStoneKeys(int color, int point);
+
+    // Key that is xored in when white is to move.
+    uint64_t SideKey();
+};
+
+#endif